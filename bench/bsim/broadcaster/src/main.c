@@ -0,0 +1,183 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Stand-in Auracast broadcaster for the BabbleSim capture bench. Advertises a Broadcast Audio
+ * Announcement with a broadcast name, creates a BIG with the configured number of BISes and keeps
+ * every BIS busy with SDUs. The number of SDUs sent is printed once per second as a BENCH line.
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/bluetooth/iso.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#define BIS_COUNT           CONFIG_BENCH_BIS_COUNT
+/* SDUs queued per BIS, one in the controller and one waiting */
+#define SDUS_IN_FLIGHT      2
+
+NET_BUF_POOL_FIXED_DEFINE(bis_tx_pool, BIS_COUNT * SDUS_IN_FLIGHT,
+			  BT_ISO_SDU_BUF_SIZE(CONFIG_BENCH_SDU_SIZE),
+			  CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+
+static K_SEM_DEFINE(sem_big_created, 0, BIS_COUNT);
+
+static struct bt_iso_chan bis_iso_chan[BIS_COUNT];
+static uint16_t seq_num[BIS_COUNT];
+static uint32_t sdus_sent[BIS_COUNT];
+static uint8_t sdu[CONFIG_BENCH_SDU_SIZE];
+
+static void iso_send(struct bt_iso_chan *chan) {
+	int i = ARRAY_INDEX(bis_iso_chan, chan);
+	struct net_buf *buf;
+	int err;
+
+	buf = net_buf_alloc(&bis_tx_pool, K_NO_WAIT);
+	if (buf == NULL) {
+		return;
+	}
+
+	/* the sequence number in the payload makes lost SDUs visible in the capture */
+	sys_put_le16(seq_num[i], sdu);
+	net_buf_reserve(buf, BT_ISO_CHAN_SEND_RESERVE);
+	net_buf_add_mem(buf, sdu, sizeof(sdu));
+
+	err = bt_iso_chan_send(chan, buf, seq_num[i]);
+	if (err < 0) {
+		printk("BIS %d: unable to send SDU %u (%d)\n", i, seq_num[i], err);
+		net_buf_unref(buf);
+		return;
+	}
+
+	seq_num[i]++;
+}
+
+static void iso_connected(struct bt_iso_chan *chan) {
+	printk("BIS %d connected\n", ARRAY_INDEX(bis_iso_chan, chan));
+	k_sem_give(&sem_big_created);
+}
+
+static void iso_disconnected(struct bt_iso_chan *chan, uint8_t reason) {
+	printk("BIS %d disconnected with reason 0x%02x\n", ARRAY_INDEX(bis_iso_chan, chan), reason);
+}
+
+static void iso_sent(struct bt_iso_chan *chan) {
+	sdus_sent[ARRAY_INDEX(bis_iso_chan, chan)]++;
+	iso_send(chan);
+}
+
+static struct bt_iso_chan_ops iso_ops = {
+	.connected = iso_connected,
+	.disconnected = iso_disconnected,
+	.sent = iso_sent,
+};
+
+static struct bt_iso_chan_io_qos iso_tx_qos = {
+	.sdu = CONFIG_BENCH_SDU_SIZE,
+	.rtn = CONFIG_BENCH_RTN,
+	.phy = BT_GAP_LE_PHY_2M,
+};
+
+static struct bt_iso_chan_qos bis_iso_qos = {
+	.tx = &iso_tx_qos,
+};
+
+static const uint8_t svc_data[] = {
+	BT_UUID_16_ENCODE(BT_UUID_BROADCAST_AUDIO_VAL),
+	BT_BYTES_LIST_LE24(CONFIG_BENCH_BROADCAST_ID),
+};
+
+static const struct bt_data ad[] = {
+	BT_DATA(BT_DATA_SVC_DATA16, svc_data, sizeof(svc_data)),
+	BT_DATA(BT_DATA_BROADCAST_NAME, CONFIG_BENCH_BROADCAST_NAME, sizeof(CONFIG_BENCH_BROADCAST_NAME) - 1),
+};
+
+int main(void) {
+	struct bt_iso_chan *bis[BIS_COUNT];
+	struct bt_iso_big_create_param big_create_param = {
+		.num_bis = BIS_COUNT,
+		.bis_channels = bis,
+		.interval = CONFIG_BENCH_SDU_INTERVAL_US,
+		.latency = CONFIG_BENCH_SDU_INTERVAL_US / USEC_PER_MSEC,
+		.packing = BT_ISO_PACKING_SEQUENTIAL,
+		.framing = BT_ISO_FRAMING_UNFRAMED,
+		.encryption = IS_ENABLED(CONFIG_BENCH_ENCRYPTION),
+	};
+	struct bt_le_ext_adv *adv;
+	struct bt_iso_big *big;
+	int64_t start;
+	int err;
+
+	for (int i = 0; i < BIS_COUNT; i++) {
+		bis_iso_chan[i].ops = &iso_ops;
+		bis_iso_chan[i].qos = &bis_iso_qos;
+		bis[i] = &bis_iso_chan[i];
+	}
+
+#if defined(CONFIG_BENCH_ENCRYPTION)
+	strncpy((char *)big_create_param.bcode, CONFIG_BENCH_BROADCAST_CODE, sizeof(big_create_param.bcode));
+#endif
+
+	err = bt_enable(NULL);
+	if (err) {
+		printk("Bluetooth init failed (%d)\n", err);
+		return 0;
+	}
+
+	err = bt_le_ext_adv_create(BT_LE_EXT_ADV_NCONN, NULL, &adv);
+	if (!err) {
+		err = bt_le_ext_adv_set_data(adv, ad, ARRAY_SIZE(ad), NULL, 0);
+	}
+	if (!err) {
+		err = bt_le_per_adv_set_param(adv, BT_LE_PER_ADV_DEFAULT);
+	}
+	if (!err) {
+		err = bt_le_per_adv_start(adv);
+	}
+	if (!err) {
+		err = bt_le_ext_adv_start(adv, BT_LE_EXT_ADV_START_DEFAULT);
+	}
+	if (err) {
+		printk("Failed to start advertising (%d)\n", err);
+		return 0;
+	}
+
+	start = k_uptime_get();
+	err = bt_iso_big_create(adv, &big_create_param, &big);
+	if (err) {
+		printk("Failed to create BIG (%d)\n", err);
+		return 0;
+	}
+
+	for (int i = 0; i < BIS_COUNT; i++) {
+		k_sem_take(&sem_big_created, K_FOREVER);
+	}
+
+	printk("BENCH big_created_ms=%lld num_bis=%d sdu_size=%d sdu_interval_us=%d encrypted=%d\n",
+	       k_uptime_get() - start, BIS_COUNT, CONFIG_BENCH_SDU_SIZE, CONFIG_BENCH_SDU_INTERVAL_US,
+	       IS_ENABLED(CONFIG_BENCH_ENCRYPTION));
+
+	for (int i = 0; i < BIS_COUNT; i++) {
+		for (int j = 0; j < SDUS_IN_FLIGHT; j++) {
+			iso_send(&bis_iso_chan[i]);
+		}
+	}
+
+	while (true) {
+		uint32_t total = 0;
+
+		k_sleep(K_SECONDS(1));
+		for (int i = 0; i < BIS_COUNT; i++) {
+			total += sdus_sent[i];
+		}
+		printk("BENCH tx uptime_ms=%lld sdus=%u\n", k_uptime_get(), total);
+	}
+
+	return 0;
+}
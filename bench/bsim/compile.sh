@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+#
+# Build the toolkit and the bench broadcaster for BabbleSim and install them into
+# ${BSIM_OUT_PATH}/bin.
+#
+#   bench/bsim/compile.sh [board]          board: nrf52_bsim (default) or nrf5340bsim/nrf5340/cpuapp
+#
+# Broadcaster parameters are Kconfig options, e.g.
+#
+#   BROADCASTER_ARGS="-DCONFIG_BENCH_BIS_COUNT=1 -DCONFIG_BENCH_ENCRYPTION=y" bench/bsim/compile.sh
+
+set -eu
+
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must point to the (patched) Zephyr tree}"
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the BabbleSim installation}"
+
+BOARD=${1:-nrf52_bsim}
+BENCH_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+APP_DIR=$(cd "${BENCH_DIR}/../.." && pwd)
+BUILD_DIR=${BUILD_DIR:-${APP_DIR}/build_bench}
+BOARD_ID=${BOARD//\//_}
+
+# build <app dir> <build dir> <executable name> [cmake args...]
+build() {
+	local app=$1 dir=$2 exe=$3
+	shift 3
+
+	west build -p auto --sysbuild -b "${BOARD}" -d "${dir}" "${app}" -- "$@"
+	# with sysbuild the default image lives in a directory named after the application
+	cp "${dir}/$(basename "${app}")/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_${BOARD_ID}_${exe}"
+}
+
+build "${APP_DIR}" "${BUILD_DIR}/toolkit" aht_bench_toolkit \
+	-DEXTRA_CONF_FILE="${BENCH_DIR}/toolkit.conf" ${TOOLKIT_ARGS:-}
+build "${BENCH_DIR}/broadcaster" "${BUILD_DIR}/broadcaster" aht_bench_broadcaster ${BROADCASTER_ARGS:-}
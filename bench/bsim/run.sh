@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+#
+# Run the capture bench built by compile.sh: the bench broadcaster and the toolkit on the
+# BabbleSim 2.4 GHz phy. The toolkit runs `scan on`, `scan biginfo` and `broadcast dump` on its
+# own (CONFIG_AHT_BENCH). Prints the discovery latency, the BIGInfo acquisition time, the time from
+# `broadcast dump` to the first PDU and the PDUs captured from then on versus the PDUs expected in
+# that window (from the ISO interval) and versus the SDUs the broadcaster sent in the same window.
+# Fails if either ratio is below MIN_CAPTURE_PERCENT.
+#
+#   bench/bsim/run.sh [board]              board: nrf52_bsim (default) or nrf5340bsim/nrf5340/cpuapp
+#
+# Environment: SIM_ID, SIM_SECONDS (simulated time, default 30), MIN_CAPTURE_PERCENT (default 99),
+# LOG_DIR (default ./bench_logs).
+
+set -eu
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the BabbleSim installation}"
+
+BOARD=${1:-nrf52_bsim}
+BOARD_ID=${BOARD//\//_}
+SIM_ID=${SIM_ID:-aht_bench_$$}
+SIM_SECONDS=${SIM_SECONDS:-30}
+MIN_CAPTURE_PERCENT=${MIN_CAPTURE_PERCENT:-99}
+LOG_DIR=$(mkdir -p "${LOG_DIR:-bench_logs}" && cd "${LOG_DIR:-bench_logs}" && pwd)
+
+cd "${BSIM_OUT_PATH}/bin"
+
+# -RealEncryption is needed for encrypted BIGs
+"./bs_${BOARD_ID}_aht_bench_broadcaster" -s="${SIM_ID}" -d=0 -RealEncryption=1 \
+	> "${LOG_DIR}/broadcaster.log" 2>&1 &
+"./bs_${BOARD_ID}_aht_bench_toolkit" -s="${SIM_ID}" -d=1 -RealEncryption=1 \
+	> "${LOG_DIR}/toolkit.log" 2>&1 &
+./bs_2G4_phy_v1 -s="${SIM_ID}" -D=2 -sim_length=$((SIM_SECONDS * 1000000)) \
+	> "${LOG_DIR}/phy.log" 2>&1
+wait
+
+result=$(grep -a "^BENCH result" "${LOG_DIR}/toolkit.log" | tail -n 1 || true)
+
+if [ -z "${result}" ]; then
+	echo "Bench did not finish:" >&2
+	grep -a "^BENCH error" "${LOG_DIR}/toolkit.log" >&2 || echo "no result within ${SIM_SECONDS} s" >&2
+	echo "Logs are in ${LOG_DIR}" >&2
+	exit 1
+fi
+
+# field <name> <line>
+field() {
+	sed -n "s/.* $1=\([0-9]*\).*/\1/p" <<< "$2"
+}
+
+pdus=$(field pdus "${result}")
+expected=$(field expected "${result}")
+window_start=$(field window_start_ms "${result}")
+window_end=$(field window_end_ms "${result}")
+percent=$(awk -v p="${pdus}" -v e="${expected}" 'BEGIN { printf "%.2f", e > 0 ? 100 * p / e : 0 }')
+
+# SDUs the broadcaster sent during the capture window. Both devices boot at the start of the simulation,
+# so their uptimes match; the once per second counters are interpolated to the window edges.
+tx_sent=$(grep -a "^BENCH tx" "${LOG_DIR}/broadcaster.log" | awk -v s="${window_start}" -v e="${window_end}" '
+	{
+		t = $3; n = $4
+		sub("uptime_ms=", "", t); sub("sdus=", "", n); t += 0; n += 0
+		if (t <= s) { t0 = t; n0 = n; have0 = 1 }
+		if (t >= e && !have1) { t1 = t; n1 = n; have1 = 1 }
+	}
+	END {
+		if (have0 && have1 && t1 > t0) printf "%d", (n1 - n0) * (e - s) / (t1 - t0)
+		else printf "0"
+	}')
+tx_percent=$(awk -v p="${pdus}" -v e="${tx_sent}" 'BEGIN { printf "%.2f", e > 0 ? 100 * p / e : 0 }')
+
+echo "Board:                 ${BOARD}"
+echo "Discovery latency:     $(field discovery_ms "${result}") ms"
+echo "BIGInfo acquisition:   $(field biginfo_ms "${result}") ms"
+echo "Sync to first PDU:     $(field sync_ms "${result}") ms"
+echo "PDUs captured:         ${pdus} of ${expected} expected in $(field window_ms "${result}") ms (${percent} %)"
+echo "SDUs sent in window:   ${tx_sent} (${tx_percent} % captured)"
+
+for p in "${percent}" "${tx_percent}"; do
+	if awk -v p="${p}" -v m="${MIN_CAPTURE_PERCENT}" 'BEGIN { exit !(p < m) }'; then
+		echo "Capture ratio below ${MIN_CAPTURE_PERCENT} %, logs are in ${LOG_DIR}" >&2
+		exit 1
+	fi
+done
@@ -0,0 +1,208 @@
+# SPDX-License-Identifier: Apache-2.0
+"""Streaming parser for Auracast Hacker's Toolkit captures.
+
+Handles both the text log written by `broadcast dump` (``PDU <pn>,<len>,<hex>`` and
+``BIGInfo <len>,<hex>`` lines, anything else is ignored) and the binary capture format
+(``AHTCAP01`` magic followed by records, see ``struct capture_record_hdr`` in
+``src/auracast_hackers_toolkit.h``).
+"""
+
+import struct
+from dataclasses import dataclass
+from typing import BinaryIO, Iterator, Optional
+
+CAPTURE_FILE_MAGIC = b"AHTCAP01"
+RECORD_HDR = struct.Struct("<BBHIQ")
+
+# capture record types (CAPTURE_RECORD_* in the firmware)
+RECORD_PDU = 0x00
+RECORD_BIGINFO = 0x01
+RECORD_PAD = 0x02
+
+# BIS PDU LLIDs
+LLID_UNFRAMED_END = 0b00
+LLID_UNFRAMED_START_CONT = 0b01
+LLID_FRAMED = 0b10
+LLID_CONTROL = 0b11
+
+
+@dataclass
+class Record:
+    type: int
+    payload_number: int
+    data: bytes
+    offset: int
+    """Byte offset of the record in the capture file."""
+    length: int
+    """Length of the record in the capture file, including line ending or header."""
+    timestamp_ms: Optional[int] = None
+
+
+def _bits(value: int, offset: int, count: int) -> int:
+    return (value >> offset) & ((1 << count) - 1)
+
+
+@dataclass
+class BigInfo:
+    """Decoded raw BIGInfo (struct pdu_big_info in the Zephyr link layer)."""
+
+    iso_interval: int
+    """ISO interval in 1.25 ms units."""
+    num_bis: int
+    nse: int
+    bn: int
+    sub_interval: int
+    pto: int
+    bis_spacing: int
+    irc: int
+    max_pdu: int
+    seed_access_address: int
+    sdu_interval: int
+    """SDU interval in us."""
+    max_sdu: int
+    base_crc_init: int
+    channel_map: int
+    phy: int
+    payload_count: int
+    framing: int
+    encrypted: bool
+
+    @classmethod
+    def parse(cls, data: bytes) -> "BigInfo":
+        if len(data) < 33:
+            raise ValueError(f"BIGInfo too short ({len(data)} bytes)")
+        w0, w1, w2 = struct.unpack_from("<III", data, 0)
+        seed, sdu = struct.unpack_from("<II", data, 13)
+        (crc,) = struct.unpack_from("<H", data, 21)
+        chm_phy = int.from_bytes(data[23:28], "little")
+        count_framing = int.from_bytes(data[28:33], "little")
+        return cls(
+            iso_interval=_bits(w0, 15, 12),
+            num_bis=_bits(w0, 27, 5),
+            nse=_bits(w1, 0, 5),
+            bn=_bits(w1, 5, 3),
+            sub_interval=_bits(w1, 8, 20),
+            pto=_bits(w1, 28, 4),
+            bis_spacing=_bits(w2, 0, 20),
+            irc=_bits(w2, 20, 4),
+            max_pdu=_bits(w2, 24, 8),
+            seed_access_address=seed,
+            sdu_interval=_bits(sdu, 0, 20),
+            max_sdu=_bits(sdu, 20, 12),
+            base_crc_init=crc,
+            channel_map=_bits(chm_phy, 0, 37),
+            phy=_bits(chm_phy, 37, 3),
+            payload_count=_bits(count_framing, 0, 39),
+            framing=_bits(count_framing, 39, 1),
+            encrypted=len(data) >= 57,
+        )
+
+    @property
+    def iso_interval_us(self) -> int:
+        return self.iso_interval * 1250
+
+    def same_big(self, other: "BigInfo") -> bool:
+        """True if both BIGInfos describe the same BIG (ignoring offsets, counters and channel map)."""
+        return (self.seed_access_address == other.seed_access_address
+                and self.base_crc_init == other.base_crc_init)
+
+
+def is_binary(f: BinaryIO) -> bool:
+    pos = f.tell()
+    magic = f.read(len(CAPTURE_FILE_MAGIC))
+    f.seek(pos)
+    return magic == CAPTURE_FILE_MAGIC
+
+
+def _parse_text_line(line: bytes, offset: int) -> Optional[Record]:
+    try:
+        if line.startswith(b"PDU "):
+            pn, length, payload = line[4:].split(b",", 2)
+            data = bytes.fromhex(payload.strip().decode())
+            if len(data) != int(length):
+                return None
+            return Record(RECORD_PDU, int(pn), data, offset, 0)
+        if line.startswith(b"BIGInfo "):
+            length, payload = line[8:].split(b",", 1)
+            data = bytes.fromhex(payload.strip().decode())
+            if len(data) != int(length):
+                return None
+            return Record(RECORD_BIGINFO, 0, data, offset, 0)
+    except ValueError:
+        pass
+    return None
+
+
+def iter_text(f: BinaryIO, offset: int = 0) -> Iterator[Record]:
+    """Yield records from a text log starting at `offset`. A trailing line without line ending is
+    not yielded, so a growing capture can be resumed from the last record's end."""
+    f.seek(offset)
+    for line in f:
+        if not line.endswith(b"\n"):
+            return
+        rec = _parse_text_line(line, offset)
+        if rec is not None:
+            rec.length = len(line)
+            yield rec
+        offset += len(line)
+
+
+def iter_binary(f: BinaryIO, offset: int = 0) -> Iterator[Record]:
+    """Yield records from a binary capture starting at `offset` (0 means after the magic). A
+    truncated trailing record is not yielded."""
+    offset = max(offset, len(CAPTURE_FILE_MAGIC))
+    f.seek(offset)
+    while True:
+        hdr = f.read(RECORD_HDR.size)
+        if len(hdr) < RECORD_HDR.size:
+            return
+        rtype, length, _, timestamp_ms, pn = RECORD_HDR.unpack(hdr)
+        data = f.read(length)
+        if len(data) < length:
+            return
+        yield Record(rtype, pn, data, offset, RECORD_HDR.size + length, timestamp_ms)
+        offset += RECORD_HDR.size + length
+
+
+def iter_records(f: BinaryIO, offset: int = 0) -> Iterator[Record]:
+    f.seek(0)
+    if is_binary(f):
+        return iter_binary(f, offset)
+    return iter_text(f, offset)
+
+
+class BisDemux:
+    """Assigns PDUs to BIS indices.
+
+    The raw dump event carries no BIS index. Within a BIG event every BIS sends the same payload
+    numbers in BIS order, so the n-th PDU seen with a given payload number belongs to BIS n. A PDU
+    that was not received shifts the following BISes of that payload number by one.
+    """
+
+    def __init__(self, num_bis: int = 1):
+        self.num_bis = max(num_bis, 1)
+        self._pn = None
+        self._seen = 0
+        self._history = {}
+
+    def reset(self, num_bis: int):
+        self.num_bis = max(num_bis, 1)
+        self._pn = None
+        self._seen = 0
+        self._history.clear()
+
+    def assign(self, payload_number: int) -> int:
+        """Return the 1-based BIS index for the next PDU with `payload_number`."""
+        if payload_number == self._pn:
+            self._seen += 1
+        else:
+            # interleaved BIGs alternate between payload numbers within one event
+            if self._pn is not None:
+                self._history[self._pn] = self._seen
+            self._seen = self._history.pop(payload_number, 0) + 1
+            self._pn = payload_number
+            # only the payload numbers of the current event can come back
+            if len(self._history) > 16:
+                for pn in sorted(self._history)[:-8]:
+                    del self._history[pn]
+        return min(self._seen, self.num_bis)
@@ -0,0 +1,408 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""Sidecar index for fast seeking in large captures.
+
+`build` writes `<capture>.idx` next to a text log or binary capture. The index is a flat array of
+fixed-size entries in file order: one per block of PDU records (with its payload number range) and
+one per BIGInfo that differs from the previous one. Running `build` again only indexes what was
+appended since and appends the new entries, `--follow` keeps doing so while a live capture grows.
+The header holds the number of valid entries and is only updated after the entries are on disk, so
+a concurrent `query` or a crash never sees a partial index.
+
+`query` memory-maps capture and index and prints matching records:
+
+    scripts/capture_index.py build pdu_log.txt
+    scripts/capture_index.py query pdu_log.txt --bis 2 --pn 1000000-1000500
+    scripts/capture_index.py query pdu_log.txt --biginfo
+    scripts/capture_index.py info pdu_log.txt
+
+A new BIG (different seed access address) starts a new segment, payload numbers are only unique
+within a segment.
+"""
+
+import argparse
+import mmap
+import os
+import struct
+import sys
+import time
+from bisect import bisect_left, bisect_right
+
+from capture import (RECORD_BIGINFO, RECORD_HDR, RECORD_PDU, BigInfo, BisDemux, Record, is_binary,
+                     iter_records, _parse_text_line)
+
+INDEX_MAGIC = b"AHTIDX02"
+# magic, entry size, entry count, indexed capture bytes, last payload number of the current segment
+# plus one (0: none), index of the current segment's last BIGInfo entry plus one (0: none), reserved
+INDEX_HDR = struct.Struct("<8sIIQQII")
+# kind, rfu, segment, record count or length, offset, end offset, first and last payload number
+INDEX_ENTRY = struct.Struct("<BBHIQQQQ")
+
+ENTRY_PDUS = 0
+ENTRY_BIGINFO = 1
+
+BLOCK_RECORDS = 256
+
+
+def biginfo_key(data: bytes) -> bytes:
+    """BIGInfo bytes without the fields that change every event (offset and payload counter)."""
+    return bytes([data[1] & 0x80]) + data[2:28] + bytes([data[32] & 0x80]) + data[33:]
+
+
+class Entry:
+    __slots__ = ("kind", "segment", "count", "offset", "end", "pn_first", "pn_last")
+
+    def __init__(self, kind, segment, count, offset, end, pn_first, pn_last):
+        self.kind = kind
+        self.segment = segment
+        self.count = count
+        self.offset = offset
+        self.end = end
+        self.pn_first = pn_first
+        self.pn_last = pn_last
+
+    @classmethod
+    def unpack_from(cls, buf, pos):
+        kind, _, segment, count, offset, end, pn_first, pn_last = INDEX_ENTRY.unpack_from(buf, pos)
+        return cls(kind, segment, count, offset, end, pn_first, pn_last)
+
+    def pack(self) -> bytes:
+        return INDEX_ENTRY.pack(self.kind, 0, self.segment, self.count, self.offset, self.end,
+                                self.pn_first, self.pn_last)
+
+
+class Index:
+    """Read-only, memory-mapped view of an index file."""
+
+    def __init__(self, path: str):
+        self.f = open(path, "rb")
+        size = os.fstat(self.f.fileno()).st_size
+        self.mm = mmap.mmap(self.f.fileno(), 0, access=mmap.ACCESS_READ) if size else b""
+        if size < INDEX_HDR.size:
+            raise ValueError(f"{path} is not a capture index")
+        (magic, entry_size, count, self.indexed_end, self.next_pn, self.biginfo_entry,
+         _) = INDEX_HDR.unpack_from(self.mm, 0)
+        if magic != INDEX_MAGIC or entry_size != INDEX_ENTRY.size:
+            raise ValueError(f"{path} is not a capture index")
+        # entries past the count are left over from an interrupted build
+        self.count = min(count, (size - INDEX_HDR.size) // INDEX_ENTRY.size)
+
+    def __len__(self):
+        return self.count
+
+    def __getitem__(self, i) -> Entry:
+        if i < 0:
+            i += self.count
+        return Entry.unpack_from(self.mm, INDEX_HDR.size + i * INDEX_ENTRY.size)
+
+    def segment_range(self, segment: int):
+        """Entry index range [lo, hi) of a segment, segments are stored in ascending order."""
+        keys = _Keys(self, lambda e: e.segment)
+        return bisect_left(keys, segment), bisect_right(keys, segment)
+
+    def close(self):
+        if self.mm:
+            self.mm.close()
+        self.f.close()
+
+
+class _Keys:
+    """Lazy sequence over one field of the entries for bisect."""
+
+    def __init__(self, index, key, lo=0, hi=None):
+        self.index = index
+        self.key = key
+        self.lo = lo
+        self.hi = len(index) if hi is None else hi
+
+    def __len__(self):
+        return self.hi - self.lo
+
+    def __getitem__(self, i):
+        return self.key(self.index[self.lo + i])
+
+
+def index_path(capture: str) -> str:
+    return capture + ".idx"
+
+
+def build(capture: str, verbose: bool = False) -> int:
+    """Index everything appended to `capture` since the last run. Returns the number of new entries.
+
+    New entries are appended after the valid ones and synced before the header is rewritten in
+    place, so the work only depends on what was appended and a concurrent `query` or a crash always
+    sees a complete index. The PDU block at the end of the capture is only indexed up to the start
+    of its last BIG event, the next run continues from there."""
+    path = index_path(capture)
+    count = 0
+    resume = 0
+    max_pn = -1
+    biginfo_entry = 0
+    segment = 0
+    big = None
+    big_key = None
+
+    try:
+        idx = Index(path)
+    except (OSError, ValueError):
+        # missing or from an older version, start over
+        idx = None
+    if idx is not None:
+        count = len(idx)
+        resume = idx.indexed_end
+        max_pn = idx.next_pn - 1
+        biginfo_entry = idx.biginfo_entry
+        # restore the state of the current segment from its last BIGInfo
+        if biginfo_entry:
+            e = idx[biginfo_entry - 1]
+            segment = e.segment
+            with open(capture, "rb") as f:
+                rec = next(iter_records(f, e.offset), None)
+            if rec is not None:
+                big = BigInfo.parse(rec.data)
+                big_key = biginfo_key(rec.data)
+        idx.close()
+
+    block = None
+    # block state before the first PDU of the last BIG event in it: count, end, first and last
+    # payload number, max_pn and the offset of that PDU
+    cut = None
+    end = resume
+    new = 0
+
+    with open(capture, "rb", buffering=1 << 20) as f, open(path, "r+b" if idx is not None else "w+b") as out:
+        if idx is None:
+            out.write(INDEX_HDR.pack(INDEX_MAGIC, INDEX_ENTRY.size, 0, 0, 0, 0, 0))
+        out.seek(INDEX_HDR.size + count * INDEX_ENTRY.size)
+
+        def write(entry):
+            nonlocal count, new
+            out.write(entry.pack())
+            count += 1
+            new += 1
+
+        def flush():
+            nonlocal block, cut
+            if block is not None:
+                write(block)
+                block = None
+                cut = None
+
+        for rec in iter_records(f, resume):
+            end = rec.offset + rec.length
+            if rec.type == RECORD_BIGINFO:
+                try:
+                    info = BigInfo.parse(rec.data)
+                except ValueError:
+                    continue
+                key = biginfo_key(rec.data)
+                if key == big_key:
+                    continue
+                flush()
+                if big is not None and not big.same_big(info):
+                    segment += 1
+                    max_pn = -1
+                big, big_key = info, key
+                pn = max(max_pn, 0)
+                write(Entry(ENTRY_BIGINFO, segment, 1, rec.offset, end, pn, pn))
+                biginfo_entry = count
+                if verbose:
+                    print(f"segment {segment}: BIGInfo change at offset {rec.offset}", file=sys.stderr)
+                continue
+
+            if rec.type != RECORD_PDU:
+                continue
+
+            pn = rec.payload_number
+            # blocks only start at the first PDU of a BIG event, so the BIS assignment can start
+            # over at every block
+            bn = max(big.bn, 1) if big else 1
+            event_start = pn > max_pn and pn % bn == 0
+            if block is not None and event_start and block.count >= BLOCK_RECORDS:
+                flush()
+            if block is None:
+                block = Entry(ENTRY_PDUS, segment, 0, rec.offset, end, pn, pn)
+            if event_start:
+                cut = (block.count, block.end, block.pn_first, block.pn_last, max_pn, rec.offset)
+            block.count += 1
+            block.end = end
+            block.pn_first = min(block.pn_first, pn)
+            block.pn_last = max(block.pn_last, pn)
+            max_pn = max(max_pn, pn)
+
+        # the last event may still be incomplete, leave it to the next run
+        if block is not None and cut is not None:
+            block.count, block.end, block.pn_first, block.pn_last, max_pn, end = cut
+            if block.count == 0:
+                block = None
+        flush()
+
+        out.truncate()
+        out.flush()
+        os.fsync(out.fileno())
+        out.seek(0)
+        out.write(INDEX_HDR.pack(INDEX_MAGIC, INDEX_ENTRY.size, count, end, max_pn + 1, biginfo_entry, 0))
+        out.flush()
+        os.fsync(out.fileno())
+
+    return new
+
+
+def format_record(rec) -> str:
+    if rec.type == RECORD_BIGINFO:
+        return f"BIGInfo {len(rec.data)},{rec.data.hex()}"
+    return f"PDU {rec.payload_number},{len(rec.data)},{rec.data.hex()}"
+
+
+def records_in(mm, binary: bool, start: int, end: int):
+    """Parse the records in mm[start:end]."""
+    pos = start
+    while pos < end:
+        if binary:
+            rtype, length, _, timestamp_ms, pn = RECORD_HDR.unpack_from(mm, pos)
+            data = bytes(mm[pos + RECORD_HDR.size:pos + RECORD_HDR.size + length])
+            yield Record(rtype, pn, data, pos, RECORD_HDR.size + length, timestamp_ms)
+            pos += RECORD_HDR.size + length
+        else:
+            nl = mm.find(b"\n", pos, end)
+            nl = end - 1 if nl < 0 else nl
+            rec = _parse_text_line(mm[pos:nl + 1], pos)
+            if rec is not None:
+                rec.length = nl + 1 - pos
+                yield rec
+            pos = nl + 1
+
+
+def query(args) -> int:
+    idx = Index(index_path(args.capture))
+    with open(args.capture, "rb") as f:
+        binary = is_binary(f)
+        mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+    if args.segment is not None:
+        segments = [args.segment]
+    else:
+        segments = sorted({idx[i].segment for i in _segment_starts(idx)})
+
+    out = sys.stdout
+    for segment in segments:
+        lo, hi = idx.segment_range(segment)
+        if lo == hi:
+            continue
+
+        if args.biginfo:
+            for i in range(lo, hi):
+                e = idx[i]
+                if e.kind != ENTRY_BIGINFO:
+                    continue
+                rec = next(records_in(mm, binary, e.offset, e.end))
+                info = BigInfo.parse(rec.data)
+                out.write(f"# segment {segment}, offset {e.offset}, after payload number {e.pn_first}: "
+                          f"{info.num_bis} BIS, ISO interval {info.iso_interval_us} us, BN {info.bn}, "
+                          f"NSE {info.nse}, IRC {info.irc}, PTO {info.pto}, max SDU {info.max_sdu}, "
+                          f"{'framed' if info.framing else 'unframed'}, "
+                          f"{'encrypted' if info.encrypted else 'unencrypted'}\n")
+                out.write(format_record(rec) + "\n")
+            continue
+
+        pn_lo, pn_hi = args.pn if args.pn else (0, 2 ** 64 - 1)
+        # payload numbers only grow within a segment, find the first block that can contain pn_lo
+        first = lo + bisect_left(_Keys(idx, lambda e: e.pn_last, lo, hi), pn_lo)
+        big = None
+        for i in range(first - 1, lo - 1, -1):
+            if idx[i].kind == ENTRY_BIGINFO:
+                big = BigInfo.parse(next(records_in(mm, binary, idx[i].offset, idx[i].end)).data)
+                break
+        demux = BisDemux(big.num_bis if big else 1)
+
+        for i in range(first, hi):
+            e = idx[i]
+            if e.pn_first > pn_hi:
+                break
+            if e.kind == ENTRY_BIGINFO:
+                big = BigInfo.parse(next(records_in(mm, binary, e.offset, e.end)).data)
+                demux.reset(big.num_bis)
+                continue
+            demux.reset(demux.num_bis)
+            for rec in records_in(mm, binary, e.offset, e.end):
+                if rec.type != RECORD_PDU:
+                    continue
+                bis = demux.assign(rec.payload_number)
+                if args.bis is not None and bis != args.bis:
+                    continue
+                if pn_lo <= rec.payload_number <= pn_hi:
+                    if args.raw:
+                        out.buffer.write(mm[rec.offset:rec.offset + rec.length])
+                    else:
+                        out.write(format_record(rec) + "\n")
+
+    mm.close()
+    idx.close()
+    return 0
+
+
+def _segment_starts(idx):
+    i = 0
+    while i < len(idx):
+        yield i
+        _, hi = idx.segment_range(idx[i].segment)
+        i = hi
+
+
+def info(args) -> int:
+    idx = Index(index_path(args.capture))
+    size = os.path.getsize(args.capture)
+    print(f"{len(idx)} entries, {idx.indexed_end} of {size} bytes indexed")
+    for start in _segment_starts(idx):
+        lo, hi = idx.segment_range(idx[start].segment)
+        pdus = [idx[i] for i in range(lo, hi) if idx[i].kind == ENTRY_PDUS]
+        changes = sum(1 for i in range(lo, hi) if idx[i].kind == ENTRY_BIGINFO)
+        pn_range = f"payload numbers {pdus[0].pn_first}-{pdus[-1].pn_last}" if pdus else "no PDUs"
+        print(f"segment {idx[start].segment}: offsets {idx[lo].offset}-{idx[hi - 1].end}, {pn_range}, "
+              f"{changes} BIGInfo changes")
+    idx.close()
+    return 0
+
+
+def parse_range(value: str):
+    lo, _, hi = value.partition("-")
+    return int(lo), int(hi) if hi else int(lo)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("build", help="create or update the index")
+    p.add_argument("capture")
+    p.add_argument("--follow", action="store_true", help="keep indexing while the capture grows")
+    p.add_argument("--interval", type=float, default=1.0, help="poll interval for --follow in seconds")
+    p.add_argument("-v", "--verbose", action="store_true")
+
+    p = sub.add_parser("query", help="print records using the index")
+    p.add_argument("capture")
+    p.add_argument("--segment", type=int, help="only this segment (default: all)")
+    p.add_argument("--bis", type=int, help="only PDUs of this BIS (1-based)")
+    p.add_argument("--pn", type=parse_range, help="payload number or range, e.g. 1000000-1000500")
+    p.add_argument("--biginfo", action="store_true", help="print every BIGInfo change")
+    p.add_argument("--raw", action="store_true", help="write the records as stored in the capture")
+
+    p = sub.add_parser("info", help="summarize the index")
+    p.add_argument("capture")
+
+    args = parser.parse_args()
+
+    if args.cmd == "build":
+        while True:
+            new = build(args.capture, args.verbose)
+            if not args.follow:
+                print(f"{new} entries added", file=sys.stderr)
+                return 0
+            time.sleep(args.interval)
+    if args.cmd == "query":
+        return query(args)
+    return info(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
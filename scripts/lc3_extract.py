@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""Extract one LC3 elementary stream per BIS from a capture.
+
+Reassembles the SDUs of unframed and framed BIS PDUs (ISOAL) using the BIGInfo found in the
+capture and writes them in the `.lc3` file format of liblc3 (readable by `dlc3`, ffmpeg and
+friends). Missing payload numbers are written as zero-length frames, which LC3 decoders treat as
+lost packets and conceal.
+
+The capture is processed as a stream, memory use only depends on the number of BISes.
+
+    scripts/lc3_extract.py pdu_log.txt -o out/broadcast --sample-rate 48000
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+from capture import (LLID_CONTROL, LLID_FRAMED, LLID_UNFRAMED_END, LLID_UNFRAMED_START_CONT,
+                     RECORD_BIGINFO, RECORD_PDU, BigInfo, BisDemux, iter_records)
+
+LC3_FILE_ID = 0xCC1C
+LC3_HEADER = struct.Struct("<HHHHHHHHH")
+
+
+class Lc3Writer:
+    """Writes a liblc3 `.lc3` file with one channel."""
+
+    def __init__(self, path: str, sample_rate: int, frame_us: int, bitrate: int):
+        self.f = open(path, "wb", buffering=1 << 20)
+        self.samples_per_frame = sample_rate * frame_us // 1000000
+        self.frames = 0
+        self.f.write(LC3_HEADER.pack(LC3_FILE_ID, LC3_HEADER.size, sample_rate // 100,
+                                     bitrate // 100, 1, frame_us // 10, 0, 0, 0))
+
+    def write(self, frame: bytes):
+        self.f.write(struct.pack("<H", len(frame)))
+        self.f.write(frame)
+        self.frames += 1
+
+    def close(self):
+        # the sample count is only known at the end, patch it into the header
+        samples = self.frames * self.samples_per_frame
+        self.f.seek(14)
+        self.f.write(struct.pack("<HH", samples & 0xFFFF, samples >> 16))
+        self.f.close()
+
+
+class BisStream:
+    """ISOAL reassembly for a single BIS."""
+
+    def __init__(self, big: BigInfo, writer: Lc3Writer, mic_len: int):
+        self.big = big
+        self.writer = writer
+        self.mic_len = mic_len
+        self.sdus_per_pdu = big.iso_interval_us / max(big.bn, 1) / big.sdu_interval
+        # unframed SDUs are carried by a whole number of PDUs
+        self.pdus_per_sdu = max(round(1 / self.sdus_per_pdu), 1)
+        self.next_pn = None
+        self.partial = bytearray()
+        # PDUs of the current unframed SDU seen so far, lost ones included
+        self.sdu_pdus = 0
+        # the current SDU lost a fragment, drop the rest of it up to the next SDU boundary
+        self.resyncing = False
+        self.sdus = 0
+        self.lost_sdus = 0
+        self.gaps = 0
+        self.malformed = 0
+
+    def _emit(self, sdu: bytes):
+        if len(sdu) > self.big.max_sdu:
+            self.malformed += 1
+            self.writer.write(b"")
+        else:
+            self.writer.write(sdu)
+        self.sdus += 1
+
+    def _gap(self, missing_pdus: int):
+        if self.big.framing:
+            # every SDU that overlaps the missing PDUs, plus the one in progress
+            lost = max(math.ceil(missing_pdus * self.sdus_per_pdu), 1 if self.partial else 0)
+            self.resyncing = missing_pdus > 0
+        else:
+            # the missing PDUs continue the SDU in progress, every SDU they touch is lost
+            span = self.sdu_pdus + missing_pdus
+            lost = math.ceil(span / self.pdus_per_sdu)
+            self.sdu_pdus = span % self.pdus_per_sdu
+            self.resyncing = self.sdu_pdus != 0
+        self.partial.clear()
+        self.gaps += 1
+        self.lost_sdus += lost
+        for _ in range(lost):
+            self.writer.write(b"")
+
+    def push(self, pn: int, pdu: bytes):
+        if self.next_pn is not None:
+            if pn < self.next_pn:
+                # duplicate or misattributed PDU
+                return
+            if pn > self.next_pn:
+                self._gap(pn - self.next_pn)
+        self.next_pn = pn + 1
+
+        if len(pdu) < 2 or pdu[1] + 2 != len(pdu):
+            self.malformed += 1
+            return
+
+        llid = pdu[0] & 0x03
+        payload = pdu[2:len(pdu) - self.mic_len] if self.mic_len and pdu[1] else pdu[2:]
+
+        if llid == LLID_CONTROL:
+            return
+        if llid == LLID_FRAMED:
+            self._push_framed(payload)
+        elif llid == LLID_UNFRAMED_START_CONT:
+            self.sdu_pdus += 1
+            if not self.resyncing:
+                self.partial += payload
+        elif llid == LLID_UNFRAMED_END:
+            self.sdu_pdus = 0
+            if self.resyncing:
+                # the SDU was already written as lost
+                self.resyncing = False
+            elif payload or self.partial:
+                self.partial += payload
+                self._emit(bytes(self.partial))
+                self.partial.clear()
+
+    def _push_framed(self, payload: bytes):
+        pos = 0
+        while pos + 2 <= len(payload):
+            sc = payload[pos] & 0x01
+            cmplt = (payload[pos] >> 1) & 0x01
+            length = payload[pos + 1]
+            seg = payload[pos + 2:pos + 2 + length]
+            pos += 2 + length
+            if len(seg) < length:
+                self.malformed += 1
+                self.partial.clear()
+                return
+            if not sc:
+                # start of an SDU, skip the 24 bit time offset
+                if self.partial:
+                    self._gap(0)
+                self.resyncing = False
+                seg = seg[3:]
+            elif self.resyncing:
+                # continuation of an SDU that was already written as lost
+                continue
+            self.partial += seg
+            if cmplt:
+                self._emit(bytes(self.partial))
+                self.partial.clear()
+
+
+def frame_duration_us(sdu_interval: int) -> int:
+    # LC3 only knows 7.5 and 10 ms frames, framed BIGs may use slightly off SDU intervals
+    return 7500 if sdu_interval < 8750 else 10000
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("capture", help="text log or binary capture")
+    parser.add_argument("-o", "--output", default=None,
+                        help="output prefix, files are named <prefix>_bis<N>.lc3 (default: capture name)")
+    parser.add_argument("--sample-rate", type=int, default=48000,
+                        help="sample rate of the LC3 codec config from the BASE (default: 48000)")
+    parser.add_argument("--mic-len", type=int, default=0,
+                        help="strip this many trailing bytes from non-empty PDUs, e.g. 4 for the MIC of "
+                             "encrypted BIGs that were dumped after decryption")
+    parser.add_argument("-v", "--verbose", action="store_true", help="report every gap")
+    args = parser.parse_args()
+
+    prefix = args.output or os.path.splitext(args.capture)[0]
+    os.makedirs(os.path.dirname(prefix) or ".", exist_ok=True)
+    big = None
+    big_count = 0
+    streams = {}
+    demux = BisDemux()
+
+    def finish():
+        for bis, s in sorted(streams.items()):
+            s.writer.close()
+            print(f"BIG {big_count - 1} BIS {bis}: {s.sdus} SDUs, {s.lost_sdus} lost in {s.gaps} gaps, "
+                  f"{s.malformed} malformed", file=sys.stderr)
+        streams.clear()
+
+    with open(args.capture, "rb", buffering=1 << 20) as f:
+        for rec in iter_records(f):
+            if rec.type == RECORD_BIGINFO:
+                try:
+                    info = BigInfo.parse(rec.data)
+                except ValueError:
+                    continue
+                if big is None or not big.same_big(info):
+                    finish()
+                    if info.encrypted and not args.mic_len:
+                        print("Warning: BIG is encrypted, the payload is only usable if it was dumped "
+                              "with the Broadcast Code (consider --mic-len 4)", file=sys.stderr)
+                    big = info
+                    big_count += 1
+                    demux.reset(big.num_bis)
+                continue
+
+            if rec.type != RECORD_PDU or big is None:
+                continue
+
+            bis = demux.assign(rec.payload_number)
+            stream = streams.get(bis)
+            if stream is None:
+                name = f"{prefix}_bis{bis}.lc3" if big_count == 1 else f"{prefix}_big{big_count - 1}_bis{bis}.lc3"
+                frame_us = frame_duration_us(big.sdu_interval)
+                writer = Lc3Writer(name, args.sample_rate, frame_us, big.max_sdu * 8 * 1000000 // frame_us)
+                stream = streams[bis] = BisStream(big, writer, args.mic_len)
+
+            gaps = stream.gaps
+            stream.push(rec.payload_number, rec.data)
+            if args.verbose and stream.gaps != gaps:
+                print(f"BIS {bis}: gap before payload number {rec.payload_number} at offset {rec.offset}",
+                      file=sys.stderr)
+
+    finish()
+
+
+if __name__ == "__main__":
+    main()
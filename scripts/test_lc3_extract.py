@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""Reassembly tests for lc3_extract.py, run with `python3 -m unittest discover scripts`."""
+
+import unittest
+
+from capture import LLID_UNFRAMED_END, LLID_UNFRAMED_START_CONT, BigInfo
+from lc3_extract import BisStream
+
+
+class FrameSink:
+    def __init__(self):
+        self.frames = []
+
+    def write(self, frame: bytes):
+        self.frames.append(frame)
+
+
+def big_info(bn: int, iso_interval_us: int = 10000, sdu_interval: int = 10000, max_sdu: int = 40,
+             framing: int = 0) -> BigInfo:
+    return BigInfo(iso_interval=iso_interval_us // 1250, num_bis=1, nse=bn, bn=bn, sub_interval=0,
+                   pto=0, bis_spacing=0, irc=1, max_pdu=max_sdu, seed_access_address=0,
+                   sdu_interval=sdu_interval, max_sdu=max_sdu, base_crc_init=0, channel_map=0,
+                   phy=2, payload_count=0, framing=framing, encrypted=False)
+
+
+def pdu(llid: int, payload: bytes) -> bytes:
+    return bytes([llid, len(payload)]) + payload
+
+
+class UnframedGapTest(unittest.TestCase):
+    def setUp(self):
+        # BN=2 with the SDU interval equal to the ISO interval: every SDU spans two PDUs
+        self.sink = FrameSink()
+        self.stream = BisStream(big_info(bn=2), self.sink, 0)
+
+    def push_sdu(self, pn: int, first: bytes, second: bytes):
+        self.stream.push(pn, pdu(LLID_UNFRAMED_START_CONT, first))
+        self.stream.push(pn + 1, pdu(LLID_UNFRAMED_END, second))
+
+    def test_dropped_start(self):
+        self.push_sdu(0, b"a" * 20, b"b" * 20)
+        # the START fragment of payload number 2 is lost
+        self.stream.push(3, pdu(LLID_UNFRAMED_END, b"d" * 20))
+        self.push_sdu(4, b"e" * 20, b"f" * 20)
+
+        self.assertEqual(self.sink.frames, [b"a" * 20 + b"b" * 20, b"", b"e" * 20 + b"f" * 20])
+        self.assertEqual(self.stream.lost_sdus, 1)
+        self.assertEqual(self.stream.malformed, 0)
+
+    def test_dropped_end(self):
+        self.stream.push(0, pdu(LLID_UNFRAMED_START_CONT, b"a" * 20))
+        # the END fragment of payload number 1 is lost, the next SDU starts cleanly
+        self.push_sdu(2, b"c" * 20, b"d" * 20)
+
+        self.assertEqual(self.sink.frames, [b"", b"c" * 20 + b"d" * 20])
+        self.assertEqual(self.stream.lost_sdus, 1)
+
+    def test_dropped_sdus(self):
+        self.push_sdu(0, b"a" * 20, b"b" * 20)
+        # payload numbers 2 to 6 are lost: two whole SDUs and the START of a third
+        self.stream.push(7, pdu(LLID_UNFRAMED_END, b"h" * 20))
+        self.push_sdu(8, b"i" * 20, b"j" * 20)
+
+        self.assertEqual(self.sink.frames, [b"a" * 20 + b"b" * 20, b"", b"", b"", b"i" * 20 + b"j" * 20])
+        self.assertEqual(self.stream.lost_sdus, 3)
+
+
+if __name__ == "__main__":
+    unittest.main()
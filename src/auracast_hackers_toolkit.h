@@ -16,11 +16,13 @@
 #include <zephyr/bluetooth/hci_types.h>
 #include <zephyr/bluetooth/iso.h>
 #include <zephyr/bluetooth/uuid.h>
+#include <zephyr/logging/log.h>
 #include <zephyr/net_buf.h>
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/shell/shell.h>
+#include <zephyr/timing/timing.h>
 
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
@@ -33,11 +35,11 @@
 #define BROADCAST_LIST_MAX_LEN              10
 #define SEM_TIMEOUT                         K_SECONDS(2)
 #define PA_SYNC_INTERVAL_TO_TIMEOUT_RATIO   5 /* Set the timeout relative to interval */
-
-#define debug_printk(format,args...)        \
-                  if (debug) {      \
-                      printk(format, ## args);    \
-                  }
+#define BIG_SYNC_TIMEOUT_DEFAULT            100 /* BIG sync timeout in 10 ms units */
+#define BIG_SYNC_INTERVAL_TO_TIMEOUT_RATIO  10 /* BIG sync timeout in ISO intervals, never below the default (low-load capture) */
+#define LOWLOAD_PA_PERIOD_MS                1000 /* only listen to a PA event about every second (low-load capture) */
+#define BIG_RESYNC_MAX_BACKOFF_MS           5000 /* upper bound for the delay between BIG resync attempts */
+#define BIG_RESYNC_MAX_ATTEMPTS             20 /* give up the BIG resync after this many failed attempts */
 
 
 struct broadcast {
@@ -53,13 +55,66 @@ struct broadcast {
      * is not forwarded in the BIGInfo HCI event */
     uint32_t sub_interval;
     uint32_t bis_spacing;
+    /* value of broadcast_seq when this entry last changed, used by `broadcast list json` */
+    uint32_t seq;
+};
+
+/* Callback probes for the `profile` command. PROFILE_START/PROFILE_END have to be used in the same
+ * scope, PROFILE_NET_BUF records the free count of the pool a buffer was allocated from. */
+enum profile_probe {
+    PROFILE_ISO_RAW_DUMP,
+    PROFILE_SCAN_RAW_BIGINFO,
+    PROFILE_SCAN_RECV,
+    PROFILE_PA_RECV,
+    PROFILE_PA_BIGINFO,
+    PROFILE_ISO_RECV,
+    PROFILE_PROBE_COUNT,
 };
 
+#if defined(CONFIG_AHT_PROFILE)
+#define PROFILE_START(probe)    timing_t _profile_start_##probe = timing_counter_get()
+#define PROFILE_END(probe)      profile_record(probe, _profile_start_##probe)
+#define PROFILE_NET_BUF(buf)    profile_net_buf(buf)
+#else
+#define PROFILE_START(probe)
+#define PROFILE_END(probe)
+#define PROFILE_NET_BUF(buf)
+#endif
+
+/* log an address as raw arguments, unlike bt_addr_le_to_str() nothing is formatted while the log
+ * message is filtered out */
+#define AHT_ADDR_LE_FMT         "%02X:%02X:%02X:%02X:%02X:%02X (type %u)"
+#define AHT_ADDR_LE_ARGS(addr)  (addr)->a.val[5], (addr)->a.val[4], (addr)->a.val[3], \
+				(addr)->a.val[2], (addr)->a.val[1], (addr)->a.val[0], (addr)->type
+
 /* this is taken from pdu.h to work without pdu_biginfo struct definition */
 #define PDU_BIG_INFO_SPACING_GET(bi) \
 	_util_get_bits(bi+8, 0, 20)
 #define PDU_BIG_INFO_SUB_INTERVAL_GET(bi) \
 	_util_get_bits(bi+5, 0, 20)
+#define PDU_BIG_INFO_ISO_INTERVAL_GET(bi) \
+	_util_get_bits(bi+1, 7, 12)
+#define PDU_BIG_INFO_BN_GET(bi) \
+	_util_get_bits(bi+4, 5, 3)
+#define PDU_BIG_INFO_NUM_BIS_GET(bi) \
+	_util_get_bits(bi+3, 3, 5)
+
+/* Binary capture format: CAPTURE_FILE_MAGIC followed by back-to-back records, each a
+ * capture_record_hdr and `len` bytes of the raw PDU or BIGInfo. All fields are little endian. */
+#define CAPTURE_FILE_MAGIC                  "AHTCAP01"
+#define CAPTURE_FILE_MAGIC_LEN              8
+
+#define CAPTURE_RECORD_PDU                  0x00
+#define CAPTURE_RECORD_BIGINFO              0x01
+#define CAPTURE_RECORD_PAD                  0x02 /* filler up to the end of a storage block, skip it */
+
+struct capture_record_hdr {
+    uint8_t type;           /* CAPTURE_RECORD_PDU, CAPTURE_RECORD_BIGINFO or CAPTURE_RECORD_PAD */
+    uint8_t len;
+    uint16_t rfu;
+    uint32_t timestamp_ms;  /* uptime when the record was captured */
+    uint64_t payload_number;
+} __packed;
 
 // Scan Commands
 int scan_on(const struct shell *sh, size_t argc, char **argv);
@@ -67,27 +122,51 @@ int scan_off(const struct shell *sh, size_t argc, char **argv);
 int scan_list(const struct shell *sh, size_t argc, char **argv);
 int scan_biginfo(const struct shell *sh, size_t argc, char **argv);
 
+// Raw ISO dump callbacks
+void iso_raw_dump_cb(struct net_buf *buf);
+void scan_raw_get_biginfo_cb(struct net_buf *buf);
+
 // Broadcast Commands
 int broadcast_list(const struct shell *sh, size_t argc, char **argv);
 int broadcast_dump(const struct shell *sh, size_t argc, char **argv);
+int broadcast_capture(const struct shell *sh, size_t argc, char **argv);
 int broadcast_bisquit(const struct shell *sh, size_t argc, char **argv);
 int broadcast_hijack(const struct shell *sh, size_t argc, char **argv);
 
 extern bool bt_enabled;
-extern bool debug;
 extern struct broadcast broadcasts[BROADCAST_LIST_MAX_LEN];
 extern uint8_t cur_bcast;
 extern struct k_sem sem_biginfo;
+extern uint32_t broadcast_seq;
+extern uint32_t broadcast_reset_seq;
 
 struct broadcast* get_broadcast_at_idx(const uint8_t idx);
 struct broadcast* get_broadcast_with_id(uint32_t broadcast_id);
 struct broadcast* get_broadcast_with_addr(const bt_addr_le_t *addr);
-int pa_sync_create(struct broadcast *b);
+int pa_sync_create(struct broadcast *b, uint16_t skip);
+void broadcast_mark_changed(struct broadcast *b);
 
 void set_active_broadcast_prompt(struct broadcast *b);
 void remove_active_broadcast_prompt();
 struct broadcast *get_active_broadcast();
 
+/* Storage sink: storage_record() returns true if the record was consumed and shouldn't be printed */
+bool storage_is_active(void);
+bool storage_record(uint8_t type, uint64_t payload_number, const uint8_t *data, uint8_t len);
+
+/* Flight recorder: recorder_record() returns true if the record was kept and shouldn't be printed */
+bool recorder_is_active(void);
+bool recorder_record(uint8_t type, uint64_t payload_number, const uint8_t *data, uint8_t len);
+void recorder_trigger(const char *reason);
+
+/* PDU count and payload number range seen by the running dump */
+void broadcast_capture_stats(uint32_t *pdus, uint64_t *first_pn, uint64_t *last_pn, int64_t *first_pdu_ms);
+
+void profile_record(enum profile_probe probe, timing_t start);
+void profile_net_buf(struct net_buf *buf);
+
 bool is_substring(const char *substr, const char *str);
 const char *phy2str(uint8_t phy);
+uint16_t interval_to_sync_timeout(uint16_t pa_interval, uint16_t skip);
+size_t json_escape(const char *in, char *out, size_t out_len);
 uint32_t _util_get_bits(uint8_t *data, uint8_t bit_offs, uint8_t num_bits);
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "auracast_hackers_toolkit.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell_dummy.h>
+
+/* Scripted capture benchmark for bench/bsim. Runs the commands an operator would type through the
+ * dummy shell backend against the first broadcast that shows up and prints BENCH lines that
+ * bench/bsim/run.sh parses. All times are in (simulated) uptime milliseconds. */
+
+static int bench_cmd(const char *cmd) {
+	const struct shell *sh = shell_backend_dummy_get_ptr();
+	const char *out;
+	size_t len;
+	int err;
+
+	shell_backend_dummy_clear_output(sh);
+	err = shell_execute_cmd(sh, cmd);
+	out = shell_backend_dummy_get_output(sh, &len);
+
+	printk("BENCH $ %s -> %d\n%s", cmd, err, len > 0 ? out : "");
+
+	return err;
+}
+
+static struct broadcast *bench_wait_for_broadcast(int *idx) {
+	int64_t start = k_uptime_get();
+
+	while (k_uptime_get() - start < CONFIG_AHT_BENCH_TIMEOUT_SECONDS * MSEC_PER_SEC) {
+		for (int i = 0; i < cur_bcast; i++) {
+			if (broadcasts[i].found) {
+				*idx = i;
+				return &broadcasts[i];
+			}
+		}
+		k_sleep(K_MSEC(1));
+	}
+
+	return NULL;
+}
+
+static void bench_fn(void *p1, void *p2, void *p3) {
+	struct broadcast *b;
+	char cmd[32];
+	int idx;
+	int64_t start;
+	int64_t discovery_ms;
+	int64_t biginfo_ms;
+	int64_t dump_start;
+	int64_t first_pdu;
+	int64_t dump_end;
+	uint32_t iso_interval_us;
+	uint32_t pdus;
+	uint64_t first_pn;
+	uint64_t last_pn;
+	uint64_t expected;
+
+	if (bench_cmd("init") != 0) {
+		printk("BENCH error init\n");
+		return;
+	}
+
+	start = k_uptime_get();
+	bench_cmd("scan on");
+	b = bench_wait_for_broadcast(&idx);
+	if (b == NULL) {
+		printk("BENCH error no broadcast found\n");
+		return;
+	}
+	discovery_ms = k_uptime_get() - start;
+
+	/* returns as soon as the raw BIGInfo arrived or SEM_TIMEOUT expired */
+	start = k_uptime_get();
+	snprintf(cmd, sizeof(cmd), "scan biginfo %d", idx);
+	bench_cmd(cmd);
+	biginfo_ms = k_uptime_get() - start;
+	if (!b->has_biginfo) {
+		printk("BENCH error no BIGInfo\n");
+		return;
+	}
+
+	snprintf(cmd, sizeof(cmd), "broadcast dump %d", idx);
+	dump_start = k_uptime_get();
+	if (bench_cmd(cmd) != 0) {
+		printk("BENCH error dump\n");
+		return;
+	}
+	k_sleep(K_SECONDS(CONFIG_AHT_BENCH_DUMP_SECONDS));
+	broadcast_capture_stats(&pdus, &first_pn, &last_pn, &first_pdu);
+	dump_end = k_uptime_get();
+	bench_cmd("broadcast dump stop");
+	if (pdus == 0) {
+		printk("BENCH error no PDUs captured\n");
+		return;
+	}
+
+	/* The window starts with the first captured PDU, the PA sync, BIGInfo and BIG sync before it
+	 * are reported as sync_ms. Within the window every BIS carries BN payload numbers per ISO
+	 * interval, independent of what was received, so later sync losses count as missed PDUs. */
+	iso_interval_us = BT_CONN_INTERVAL_TO_US(b->biginfo.iso_interval);
+	expected = ((uint64_t)(dump_end - first_pdu) * USEC_PER_MSEC / MAX(iso_interval_us, 1) + 1) *
+		   b->biginfo.burst_number * b->biginfo.num_bis;
+
+	printk("BENCH result discovery_ms=%lld biginfo_ms=%lld sync_ms=%lld num_bis=%u window_start_ms=%lld "
+	       "window_end_ms=%lld window_ms=%lld pdus=%u expected=%llu first_pn=%llu last_pn=%llu\n",
+	       discovery_ms, biginfo_ms, first_pdu - dump_start, b->biginfo.num_bis, first_pdu, dump_end,
+	       dump_end - first_pdu, pdus, expected, first_pn, last_pn);
+}
+
+/* give the shell a moment to initialize its backends */
+K_THREAD_DEFINE(bench_thread, CONFIG_AHT_BENCH_STACK_SIZE, bench_fn, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 100);
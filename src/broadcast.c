@@ -1,7 +1,60 @@
 #include "auracast_hackers_toolkit.h"
 
+#include <zephyr/random/random.h>
+
+LOG_MODULE_REGISTER(aht_broadcast, CONFIG_AHT_LOG_LEVEL);
+
 struct bt_iso_big *big;
 
+/* monotonically increasing change counter over all broadcast entries */
+uint32_t broadcast_seq;
+/* value of broadcast_seq at the last `reset`, clients with an older cursor must drop their table */
+uint32_t broadcast_reset_seq;
+/* random per boot, part of the JSON cursor so a cursor from before a reboot is never mistaken for a
+ * current one once broadcast_seq has caught up */
+static uint32_t broadcast_session;
+
+void broadcast_mark_changed(struct broadcast *b) {
+    b->seq = ++broadcast_seq;
+}
+
+/* capture profile used by `broadcast dump`, see `broadcast capture` */
+static bool capture_lowload;
+
+/* sync parameters and event counters of the running dump */
+static struct {
+    uint16_t pa_skip;
+    uint16_t pa_timeout;
+    uint8_t mse;
+    uint16_t big_sync_timeout;
+    int64_t start;
+    uint32_t pdus;
+    uint32_t biginfos;
+    uint64_t first_pn;
+    uint64_t last_pn;
+    int64_t first_pdu;
+} capture;
+
+/* BIG sync parameters of the running dump, kept for the automatic resync */
+static struct bt_iso_big_sync_param big_sync_param;
+
+/* automatic BIG resync after a sync loss, see iso_disconnected() */
+static struct {
+    bool enabled;       /* a `broadcast dump` is running */
+    bool established;   /* the BIG sync of the dump came up at least once */
+    bool lost;          /* BIG sync is gone, recovery in progress */
+    bool pa_lost;       /* the PA sync is gone as well and has to be recreated first */
+    bool report_gap;    /* report the gap with the first PDU after the resync */
+    uint32_t attempts;
+    uint32_t backoff_ms;
+    uint32_t resyncs;
+    uint64_t last_pn;
+    int64_t last_pdu;
+} resync;
+
+static void big_resync_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(big_resync_work, big_resync_fn);
+
 struct broadcast* get_broadcast_at_idx(const uint8_t idx) {
     if (idx > cur_bcast || idx > ARRAY_SIZE(broadcasts)) {
         return NULL;
@@ -39,27 +92,139 @@ bool broadcast_is_interleaved(const struct broadcast *b) {
 
 void iso_raw_dump_cb(struct net_buf *buf) {
 
+	PROFILE_START(PROFILE_ISO_RAW_DUMP);
+	PROFILE_NET_BUF(buf);
+
 	struct bt_hci_evt_iso_raw_dump *evt = (void *)buf->data;
+	uint8_t *data = buf->data + sizeof(*evt);
+	bool is_pdu = evt->type == BT_HCI_EVT_ISO_RAW_DUMP_PDU;
+	bool print = true;
 	char hexout[256 * 2];
  
     // TODO: make this configurable
 	size_t print_interval = 1;
 
-	bin2hex(buf->data + sizeof(*evt), evt->len, hexout, sizeof(hexout));
-	if (evt->type == BT_HCI_EVT_ISO_RAW_DUMP_PDU) {
+	// the storage sink replaces the console output unless it echoes
+	if (IS_ENABLED(CONFIG_AHT_STORAGE) && storage_is_active()) {
+		print = !storage_record(is_pdu ? CAPTURE_RECORD_PDU : CAPTURE_RECORD_BIGINFO,
+					evt->payload_number, data, evt->len);
+	}
+
+	// the flight recorder only prints when triggered
+	if (IS_ENABLED(CONFIG_AHT_RECORDER) && recorder_is_active()) {
+		print = !recorder_record(is_pdu ? CAPTURE_RECORD_PDU : CAPTURE_RECORD_BIGINFO,
+					 evt->payload_number, data, evt->len) && print;
+	}
+
+	if (is_pdu) {
+		if (capture.pdus++ == 0) {
+			capture.first_pn = evt->payload_number;
+			capture.first_pdu = k_uptime_get();
+		}
+		capture.last_pn = evt->payload_number;
+		if (resync.report_gap) {
+			resync.report_gap = false;
+			LOG_INF("BIG resynced after %u attempts: gap of %llu payload numbers, %lld ms",
+			       resync.attempts,
+			       evt->payload_number > resync.last_pn ? evt->payload_number - resync.last_pn - 1 : 0,
+			       k_uptime_get() - resync.last_pdu);
+		}
+		resync.last_pn = evt->payload_number;
+		resync.last_pdu = k_uptime_get();
 		// Only log packets that carry data (header is 2 bytes)
-		if (evt->payload_number % print_interval == 0) {
+		if (print && evt->payload_number % print_interval == 0) {
+			bin2hex(data, evt->len, hexout, sizeof(hexout));
 		    printk("PDU %lld,%d,%s\r\n", evt->payload_number, evt->len, hexout);
 		}
 	} else if (evt->type == BT_HCI_EVT_ISO_RAW_DUMP_BIG) {
-		printk("BIGInfo %d,%s\r\n", evt->len, hexout);
+		capture.biginfos++;
+		if (print) {
+			bin2hex(data, evt->len, hexout, sizeof(hexout));
+			printk("BIGInfo %d,%s\r\n", evt->len, hexout);
+		}
         k_sem_give(&sem_biginfo);
 	}
+
+	PROFILE_END(PROFILE_ISO_RAW_DUMP);
+}
+
+/* Print one JSON object per line for every entry that changed after `cursor_str`, followed by a
+ * trailer line carrying the cursor to use for the next call. Cursors are "<session>:<seq>", the
+ * session is random per boot. */
+static int broadcast_list_json(const struct shell *sh, const char *cursor_str) {
+    uint32_t seq = broadcast_seq;
+    uint32_t session = 0;
+    uint32_t cursor = 0;
+    int count = 0;
+
+    if (broadcast_session == 0) {
+        broadcast_session = sys_rand32_get() | 1;
+    }
+
+    if (cursor_str != NULL) {
+        char *p;
+
+        session = strtoul(cursor_str, &p, 16);
+        cursor = *p == ':' ? strtoul(p + 1, NULL, 10) : 0;
+    }
+
+    /* a cursor from another boot, from before a `reset` or a malformed one: start over */
+    if (cursor_str != NULL &&
+        (session != broadcast_session || cursor < broadcast_reset_seq || cursor > seq)) {
+        shell_print(sh, "{\"reset\":true}");
+        cursor = 0;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(broadcasts); i++) {
+        struct broadcast *b = &broadcasts[i];
+        char le_addr[BT_ADDR_LE_STR_LEN];
+        char name[BROADCAST_MAX_NAME_LEN * 2];
+
+        if (bt_addr_le_eq(&b->broadcaster_addr, &bt_addr_le_any) || b->seq <= cursor || b->seq > seq) {
+            continue;
+        }
+
+        bt_addr_le_to_str(&b->broadcaster_addr, le_addr, sizeof(le_addr));
+        json_escape(b->broadcaster_name, name, sizeof(name));
+
+        if (b->has_biginfo) {
+            struct bt_iso_biginfo *biginfo = &b->biginfo;
+            shell_print(sh, "{\"idx\":%d,\"seq\":%u,\"id\":%u,\"addr\":\"%s\",\"name\":\"%s\","
+                "\"sid\":%u,\"pa_interval\":%u,\"biginfo\":{\"num_bis\":%u,\"nse\":%u,"
+                "\"iso_interval\":%u,\"bn\":%u,\"pto\":%u,\"irc\":%u,\"max_pdu\":%u,"
+                "\"sdu_interval\":%u,\"max_sdu\":%u,\"phy\":%u,\"framing\":%u,"
+                "\"encryption\":%s,\"bis_spacing\":%u,\"sub_interval\":%u}}",
+                i, b->seq, b->broadcast_id, le_addr, name,
+                b->broadcaster_info.sid, b->broadcaster_info.interval,
+                biginfo->num_bis, biginfo->sub_evt_count, biginfo->iso_interval,
+                biginfo->burst_number, biginfo->offset, biginfo->rep_count,
+                biginfo->max_pdu, biginfo->sdu_interval, biginfo->max_sdu,
+                biginfo->phy, biginfo->framing,
+                biginfo->encryption ? "true" : "false",
+                b->bis_spacing, b->sub_interval);
+        } else {
+            shell_print(sh, "{\"idx\":%d,\"seq\":%u,\"id\":%u,\"addr\":\"%s\",\"name\":\"%s\","
+                "\"sid\":%u,\"pa_interval\":%u}",
+                i, b->seq, b->broadcast_id, le_addr, name,
+                b->broadcaster_info.sid, b->broadcaster_info.interval);
+        }
+        count++;
+    }
+
+    shell_print(sh, "{\"cursor\":\"%08x:%u\",\"count\":%d}", broadcast_session, seq, count);
+
+    return 0;
 }
 
 int broadcast_list(const struct shell *sh, size_t argc, char **argv) {
-    ARG_UNUSED(argc);
-    ARG_UNUSED(argv);
+
+    if (argc >= 2) {
+        if (strcmp(argv[1], "json") != 0) {
+            shell_error(sh, "Unknown list format %s. Use `broadcast list json [cursor]`.", argv[1]);
+            return 1;
+        }
+        return broadcast_list_json(sh, argc >= 3 ? argv[2] : NULL);
+    }
 
     for (int i = 0; i < ARRAY_SIZE(broadcasts); i++){
         struct broadcast *b = &broadcasts[i];
@@ -97,15 +262,266 @@ int broadcast_list(const struct shell *sh, size_t argc, char **argv) {
     return 0;
 }
 
+/* Only listen to a PA event about every LOWLOAD_PA_PERIOD_MS, BIGInfo is repeated in every one of them */
+static uint16_t lowload_pa_skip(const struct broadcast *b) {
+    uint32_t interval_ms = BT_GAP_PER_ADV_INTERVAL_TO_MS(b->broadcaster_info.interval);
+
+    if (interval_ms == 0 || interval_ms >= LOWLOAD_PA_PERIOD_MS) {
+        return 0;
+    }
+
+    return MIN(LOWLOAD_PA_PERIOD_MS / interval_ms - 1, BT_GAP_PER_ADV_MAX_SKIP);
+}
+
+/* The NSE subevents of a BIS form NSE / BN groups of BN subevents. The first IRC groups carry the
+ * payloads of this event (the first one plus IRC - 1 repetitions), the remaining ones carry
+ * pre-transmissions of payloads PTO events ahead. Every group after the first is a second chance
+ * for some payload, so keeping two of them (a repetition if IRC > 1, otherwise the first
+ * pre-transmission group) means a single missed subevent doesn't cost a PDU. */
+static uint8_t lowload_groups(const struct bt_iso_biginfo *biginfo) {
+    uint8_t groups = biginfo->sub_evt_count / MAX(biginfo->burst_number, 1);
+
+    return MAX(MIN(groups, 2), 1);
+}
+
+static uint8_t lowload_mse(const struct bt_iso_biginfo *biginfo) {
+    uint8_t mse = biginfo->burst_number * lowload_groups(biginfo);
+
+    return CLAMP(MIN(mse, biginfo->sub_evt_count), BT_ISO_SYNC_MSE_MIN, BT_ISO_SYNC_MSE_MAX);
+}
+
+/* BIG_SYNC_INTERVAL_TO_TIMEOUT_RATIO ISO intervals, stretched by the share of groups that are no
+ * longer listened to (a dropped group is a lost chance to receive the payload in every event).
+ * Never below the default 1 s, which is what applies to the common 7.5 and 10 ms ISO intervals. */
+static uint16_t lowload_big_sync_timeout(const struct bt_iso_biginfo *biginfo) {
+    uint8_t groups = MAX(biginfo->sub_evt_count / MAX(biginfo->burst_number, 1), 1);
+    /* ISO interval is in 1.25 ms units, the timeout in 10 ms units */
+    uint32_t timeout = (biginfo->iso_interval * 5 / 4) * BIG_SYNC_INTERVAL_TO_TIMEOUT_RATIO * groups /
+                       (lowload_groups(biginfo) * 10);
+
+    return CLAMP(MAX(timeout, BIG_SYNC_TIMEOUT_DEFAULT), BT_ISO_SYNC_TIMEOUT_MIN, BT_ISO_SYNC_TIMEOUT_MAX);
+}
+
+/* Air time of a packet with `len` payload bytes in µs: preamble, access address, header, MIC and
+ * CRC on top of the payload */
+static uint32_t phy_airtime_us(uint8_t phy, uint16_t len) {
+    uint32_t bits = (1 + 4 + 2 + len + 3) * 8;
+
+    switch (phy) {
+    case BT_GAP_LE_PHY_2M: return bits / 2;
+    case BT_GAP_LE_PHY_CODED: return bits * 8;
+    default: return bits;
+    }
+}
+
+/* Estimated radio-on time in µs per second for the given sync parameters. PA events are assumed
+ * to carry a maximum size AUX_SYNC_IND on the 1M PHY. */
+static uint32_t capture_radio_on_us(const struct broadcast *b, uint16_t pa_skip, uint8_t mse) {
+    const struct bt_iso_biginfo *biginfo = &b->biginfo;
+    uint32_t pa_interval_us = BT_CONN_INTERVAL_TO_US(b->broadcaster_info.interval) * (pa_skip + 1);
+    uint32_t iso_interval_us = BT_CONN_INTERVAL_TO_US(biginfo->iso_interval);
+    uint16_t pdu_len = biginfo->max_pdu + (biginfo->encryption ? 4 : 0); /* MIC */
+    uint32_t radio_on = 0;
+
+    /* without a limit the controller listens to every subevent */
+    if (mse == BT_ISO_SYNC_MSE_ANY) {
+        mse = biginfo->sub_evt_count;
+    }
+
+    if (pa_interval_us > 0) {
+        radio_on += (USEC_PER_SEC / pa_interval_us) * phy_airtime_us(BT_GAP_LE_PHY_1M, UINT8_MAX);
+    }
+    if (iso_interval_us > 0) {
+        radio_on += (USEC_PER_SEC / iso_interval_us) * biginfo->num_bis * mse *
+                    phy_airtime_us(biginfo->phy, pdu_len);
+    }
+
+    return MIN(radio_on, USEC_PER_SEC);
+}
+
+int broadcast_capture(const struct shell *sh, size_t argc, char **argv) {
+    struct broadcast *b;
+
+    if (argc >= 2) {
+        if (strcmp(argv[1], "lowload") == 0) {
+            capture_lowload = true;
+        } else if (strcmp(argv[1], "full") == 0) {
+            capture_lowload = false;
+        } else {
+            shell_error(sh, "Unknown capture profile %s, use `full` or `lowload`.", argv[1]);
+            return 1;
+        }
+    }
+
+    shell_print(sh, "Capture profile: %s", capture_lowload ? "lowload" : "full");
+
+    b = get_active_broadcast();
+    if (b == NULL || !b->has_biginfo) {
+        return 0;
+    }
+
+    int64_t elapsed_ms = MAX(k_uptime_get() - capture.start, 1);
+    uint8_t nse = b->biginfo.sub_evt_count;
+    uint32_t full_us = capture_radio_on_us(b, 0, nse);
+    uint32_t active_us = capture_radio_on_us(b, capture.pa_skip, capture.mse);
+    uint8_t mse = capture.mse == BT_ISO_SYNC_MSE_ANY ? nse : capture.mse;
+
+    shell_print(sh, "Active dump: PA skip %u (timeout %u ms), MSE %u of %u subevents, BIG sync timeout %u ms",
+                capture.pa_skip, capture.pa_timeout * 10, mse, nse, capture.big_sync_timeout * 10);
+    shell_print(sh, "Radio-on time (estimate from the BIGInfo, not measured): %u µs/s (full profile: %u µs/s)",
+                active_us, full_us);
+    shell_print(sh, "Events in %lld s: %u PDUs (%lld/s), %u BIGInfos (%lld/s)", elapsed_ms / MSEC_PER_SEC,
+                capture.pdus, ((int64_t)capture.pdus * MSEC_PER_SEC) / elapsed_ms,
+                capture.biginfos, ((int64_t)capture.biginfos * MSEC_PER_SEC) / elapsed_ms);
+    shell_print(sh, "BIG resyncs: %u%s", resync.resyncs,
+                resync.lost ? ", sync lost, resync in progress" : "");
+
+    return 0;
+}
+
+void broadcast_capture_stats(uint32_t *pdus, uint64_t *first_pn, uint64_t *last_pn, int64_t *first_pdu_ms) {
+    *pdus = capture.pdus;
+    *first_pn = capture.first_pn;
+    *last_pn = capture.last_pn;
+    *first_pdu_ms = capture.first_pdu;
+}
+
 static void iso_recv(struct bt_iso_chan *chan, const struct bt_iso_recv_info *info, struct net_buf *buf) {
+	PROFILE_START(PROFILE_ISO_RECV);
+	PROFILE_NET_BUF(buf);
+	PROFILE_END(PROFILE_ISO_RECV);
+}
+
+/* Stop resyncing, the dump stays stopped until `broadcast dump stop` and a new `broadcast dump` */
+static void big_resync_give_up(const char *why) {
+    LOG_WRN("Giving up BIG resync after %u attempts: %s", resync.attempts, why);
+    resync.enabled = false;
+    resync.lost = false;
+}
+
+/* Schedule the next BIG resync attempt. The first one waits a single ISO interval, every failed
+ * attempt doubles the delay up to BIG_RESYNC_MAX_BACKOFF_MS, after BIG_RESYNC_MAX_ATTEMPTS the
+ * resync is abandoned. */
+static void big_resync_schedule(void) {
+    struct broadcast *b = get_active_broadcast();
+
+    if (resync.lost && resync.attempts >= BIG_RESYNC_MAX_ATTEMPTS) {
+        big_resync_give_up("broadcaster not found");
+        return;
+    }
+
+    if (!resync.lost) {
+        resync.lost = true;
+        resync.attempts = 0;
+        resync.backoff_ms = MAX(BT_CONN_INTERVAL_TO_US(b->biginfo.iso_interval) / USEC_PER_MSEC, 1);
+        if (resync.last_pdu == 0) {
+            resync.last_pdu = k_uptime_get();
+        }
+    } else {
+        resync.backoff_ms = MIN(resync.backoff_ms * 2, BIG_RESYNC_MAX_BACKOFF_MS);
+    }
+
+    LOG_DBG("BIG resync attempt %u in %u ms", resync.attempts + 1, resync.backoff_ms);
+    k_work_reschedule(&big_resync_work, K_MSEC(resync.backoff_ms));
 }
 
+static void big_resync_fn(struct k_work *work) {
+    struct broadcast *b = get_active_broadcast();
+    int err;
+
+    if (!resync.enabled || !resync.lost || b == NULL) {
+        return;
+    }
+
+    resync.attempts++;
+
+    /* without a PA sync there is no BIGInfo to sync to, continue once resync_pa_synced() fires. The
+     * PA keeps the skip of the low-load profile, so the BIGInfo may take up to about
+     * LOWLOAD_PA_PERIOD_MS to show up after the sync is established. */
+    if (resync.pa_lost) {
+        err = pa_sync_create(b, capture.pa_skip);
+        if (err) {
+            LOG_WRN("BIG resync attempt %u: error syncing to periodic advertisments (%d)", resync.attempts, err);
+            big_resync_schedule();
+        }
+        return;
+    }
+
+    /* the cached BIGInfo and sync parameters are still valid, the broadcaster didn't change */
+    err = bt_iso_big_sync(b->broadcast_sync, &big_sync_param, &big);
+    if (err) {
+        LOG_WRN("BIG resync attempt %u: error establishing BIG sync (%d)", resync.attempts, err);
+        big_resync_schedule();
+    }
+}
+
+static void resync_pa_synced(struct bt_le_per_adv_sync *sync, struct bt_le_per_adv_sync_synced_info *info) {
+    struct broadcast *b = get_active_broadcast();
+
+    if (resync.enabled && resync.pa_lost && b != NULL && sync == b->broadcast_sync) {
+        resync.pa_lost = false;
+        k_work_reschedule(&big_resync_work, K_NO_WAIT);
+    }
+}
+
+static void resync_pa_term(struct bt_le_per_adv_sync *sync, const struct bt_le_per_adv_sync_term_info *info) {
+    struct broadcast *b = get_active_broadcast();
+
+    if (!resync.enabled || b == NULL || sync != b->broadcast_sync) {
+        return;
+    }
+
+    resync.pa_lost = true;
+    /* a PA sync created by a resync attempt failed, try again */
+    if (resync.lost && !k_work_delayable_is_pending(&big_resync_work)) {
+        big_resync_schedule();
+    }
+}
+
+static struct bt_le_per_adv_sync_cb resync_pa_callbacks = {
+    .synced = resync_pa_synced,
+    .term = resync_pa_term,
+};
+
 static void iso_connected(struct bt_iso_chan *chan) {
 	printk("ISO Channel %p connected\n", chan);
+
+	resync.established = true;
+
+	if (resync.lost) {
+		resync.lost = false;
+		resync.resyncs++;
+		resync.report_gap = true;
+	}
 }
 
 static void iso_disconnected(struct bt_iso_chan *chan, uint8_t reason) {
 	printk("ISO Channel %p disconnected with reason 0x%02x\n", chan, reason);
+
+	if (reason == BT_HCI_ERR_LOCALHOST_TERM_CONN) {
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_AHT_RECORDER) && !resync.lost) {
+		recorder_trigger("sync lost");
+	}
+
+	/* a wrong broadcast code won't get better by retrying, neither does a sync that never came up */
+	if (resync.enabled && (reason == BT_HCI_ERR_TERM_DUE_TO_MIC_FAIL ||
+			       (reason == BT_HCI_ERR_CONN_FAIL_TO_ESTAB && !resync.established))) {
+		big = NULL;
+		k_work_cancel_delayable(&big_resync_work);
+		big_resync_give_up(reason == BT_HCI_ERR_TERM_DUE_TO_MIC_FAIL ?
+				   "MIC failure, check the broadcast code" : "BIG sync failed to establish");
+		return;
+	}
+
+	/* every BIS channel of the BIG reports the loss, only the first one schedules the resync */
+	if (resync.enabled && k_work_delayable_busy_get(&big_resync_work) == 0) {
+		/* the host releases the BIG after this callback */
+		big = NULL;
+		big_resync_schedule();
+	}
 }
 
 /* TODO: currently this hard-codes a BIG with 2 BIS */
@@ -148,15 +564,26 @@ int broadcast_dump(const struct shell *sh, size_t argc, char **argv) {
     if (strcmp(argv[1], "stop") == 0) {
         b = get_active_broadcast();
         if(b) {
-            err = bt_iso_big_terminate(big);
-            if (err) {
-                shell_error(sh, "Error terminating BIG: %d", err);
-                return 1;
+            resync.enabled = false;
+            k_work_cancel_delayable_sync(&big_resync_work, &(struct k_work_sync){0});
+            if (resync.lost) {
+                shell_info(sh, "Giving up BIG resync after %u attempts", resync.attempts);
             }
-            err = bt_le_per_adv_sync_delete(b->broadcast_sync);
-            if (err) {
-                shell_error(sh, "Error terminating periodic advertisment sync: %d", err);
-                return 1;
+
+            /* while resyncing there may be no BIG or PA sync left to terminate */
+            if (big != NULL) {
+                err = bt_iso_big_terminate(big);
+                if (err) {
+                    shell_error(sh, "Error terminating BIG: %d", err);
+                    return 1;
+                }
+            }
+            if (!resync.pa_lost) {
+                err = bt_le_per_adv_sync_delete(b->broadcast_sync);
+                if (err) {
+                    shell_error(sh, "Error terminating periodic advertisment sync: %d", err);
+                    return 1;
+                }
             }
             // unregister raw iso callback
             bt_hci_iso_raw_dump_cb_register(NULL);
@@ -182,8 +609,28 @@ int broadcast_dump(const struct shell *sh, size_t argc, char **argv) {
 
     b = get_broadcast_at_idx(broadcast_idx);
     if (b) {
+        static bool resync_pa_callbacks_registered;
+
+        if (!resync_pa_callbacks_registered) {
+            bt_le_per_adv_sync_cb_register(&resync_pa_callbacks);
+            resync_pa_callbacks_registered = true;
+        }
+        memset(&resync, 0x00, sizeof(resync));
+
+        memset(&capture, 0x00, sizeof(capture));
+        capture.start = k_uptime_get();
+        capture.mse = BT_ISO_SYNC_MSE_ANY;
+        capture.big_sync_timeout = BIG_SYNC_TIMEOUT_DEFAULT;
+
+        /* PA skip only applies once synced, the first PA event still delivers the BIGInfo. It
+         * needs a BIGInfo from `scan biginfo` to know whether skipping is worth it. */
+        if (capture_lowload && b->has_biginfo) {
+            capture.pa_skip = lowload_pa_skip(b);
+        }
+        capture.pa_timeout = interval_to_sync_timeout(b->broadcaster_info.interval, capture.pa_skip);
+
         bt_hci_iso_raw_dump_cb_register(iso_raw_dump_cb);
-        pa_sync_create(b);
+        pa_sync_create(b, capture.pa_skip);
 
         err = k_sem_take(&sem_biginfo, SEM_TIMEOUT);
         if (err) {
@@ -192,17 +639,23 @@ int broadcast_dump(const struct shell *sh, size_t argc, char **argv) {
 
         if (b->has_biginfo) {
             struct bt_iso_biginfo *biginfo = &b->biginfo;
-            struct bt_iso_big_sync_param big_sync_param = {
+
+            if (capture_lowload) {
+                capture.mse = lowload_mse(biginfo);
+                capture.big_sync_timeout = lowload_big_sync_timeout(biginfo);
+            }
+
+            big_sync_param = (struct bt_iso_big_sync_param){
                 .bis_channels = bis,
                 .num_bis = biginfo->num_bis,
                 .bis_bitfield = (BIT_MASK(biginfo->num_bis)),
-                .mse = BT_ISO_SYNC_MSE_ANY, /* any number of subevents */
-                .sync_timeout = 100, /* in 10 ms units */
+                .mse = capture.mse, /* BT_ISO_SYNC_MSE_ANY unless low-load */
+                .sync_timeout = capture.big_sync_timeout, /* in 10 ms units */
                 .encryption = biginfo->encryption,
             };
 
             if (broadcast_code != NULL) {
-                strncpy(broadcast_code, big_sync_param.bcode, 16);
+                strncpy((char *)big_sync_param.bcode, broadcast_code, sizeof(big_sync_param.bcode));
             }
 
             /* if the stream is encrypted and we don't have a broadcast code supplied we disable MIC checks and decryption */
@@ -222,6 +675,13 @@ int broadcast_dump(const struct shell *sh, size_t argc, char **argv) {
             }
 
             set_active_broadcast_prompt(b);
+            resync.enabled = true;
+            if (capture_lowload) {
+                shell_info(sh, "Low-load capture: PA skip %u, MSE %u of %u, estimated radio-on %u µs/s instead of %u µs/s (not measured). Check with `broadcast capture`.",
+                           capture.pa_skip, capture.mse, biginfo->sub_evt_count,
+                           capture_radio_on_us(b, capture.pa_skip, capture.mse),
+                           capture_radio_on_us(b, 0, biginfo->sub_evt_count));
+            }
             shell_info(sh, "Starting to dump ISO packets. Stop with `broadcast dump stop`!");
         } else {
             shell_error(sh, "Error: broadcast 0x%x does not have BIGInfo yet, run scan biginfo first!", b->broadcast_id);
@@ -274,7 +734,7 @@ int broadcast_bisquit(const struct shell *sh, size_t argc, char **argv) {
 
     if (b) {
         //bt_hci_iso_raw_dump_cb_register(iso_raw_dump_cb);
-        pa_sync_create(b);
+        pa_sync_create(b, 0);
 
         err = k_sem_take(&sem_biginfo, SEM_TIMEOUT);
         if (err) {
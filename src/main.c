@@ -1,7 +1,9 @@
 #include "auracast_hackers_toolkit.h"
 
+#include <zephyr/logging/log_ctrl.h>
+
 bool bt_enabled = false;
-bool debug = false;
+static bool debug = false;
 
 static struct shell *gshell;
 struct broadcast *active_broadcast = NULL;
@@ -44,34 +46,13 @@ static int reset(const struct shell *sh, size_t argc, char **argv) {
 
 	memset(broadcasts, 0x00, sizeof(broadcasts));
 	cur_bcast = 0;
+	broadcast_reset_seq = ++broadcast_seq;
 
 	broadcaster_broadcast_id = BT_BAP_INVALID_BROADCAST_ID;
 
 	return 0;
 }
 
-static uint16_t interval_to_sync_timeout(uint16_t pa_interval)
-{
-	uint16_t pa_timeout;
-
-	if (pa_interval == BT_BAP_PA_INTERVAL_UNKNOWN) {
-		/* Use maximum value to maximize chance of success */
-		pa_timeout = BT_GAP_PER_ADV_MAX_TIMEOUT;
-	} else {
-		uint32_t interval_ms;
-		uint32_t timeout;
-
-		/* Add retries and convert to unit in 10's of ms */
-		interval_ms = BT_GAP_PER_ADV_INTERVAL_TO_MS(pa_interval);
-		timeout = (interval_ms * PA_SYNC_INTERVAL_TO_TIMEOUT_RATIO) / 10;
-
-		/* Enforce restraints */
-		pa_timeout = CLAMP(timeout, BT_GAP_PER_ADV_MIN_TIMEOUT, BT_GAP_PER_ADV_MAX_TIMEOUT);
-	}
-
-	return pa_timeout;
-}
-
 void set_active_broadcast_prompt(struct broadcast *b) {
 	
 	int err;
@@ -100,20 +81,37 @@ struct broadcast *get_active_broadcast() {
 	return active_broadcast;
 }
 
+/* Switch the runtime level of all toolkit log modules (aht_*) on all backends. Finer control is
+ * available through the `log` shell command. */
+static void debug_set(bool enable) {
+#if defined(CONFIG_LOG_RUNTIME_FILTERING)
+	uint32_t sources = log_src_cnt_get(Z_LOG_LOCAL_DOMAIN_ID);
+
+	for (uint32_t i = 0; i < sources; i++) {
+		const char *name = log_source_name_get(Z_LOG_LOCAL_DOMAIN_ID, i);
+
+		if (name != NULL && strncmp(name, "aht_", 4) == 0) {
+			log_filter_set(NULL, Z_LOG_LOCAL_DOMAIN_ID, i, enable ? LOG_LEVEL_DBG : LOG_LEVEL_INF);
+		}
+	}
+#endif
+	debug = enable;
+}
+
 int debug_on(const struct shell *sh, size_t argc, char **argv) {
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
-    ARG_UNUSED(sh);
-	debug = true;
+	debug_set(true);
 	shell_print(sh, "Debug output enabled");
+	return 0;
 }
 
 int debug_off(const struct shell *sh, size_t argc, char **argv) {
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
-    ARG_UNUSED(sh);
-	debug = false;
+	debug_set(false);
 	shell_print(sh, "Debug output disabled");
+	return 0;
 }
 
 int debug_handler(const struct shell *sh, size_t argc, char **argv) {
@@ -131,8 +129,9 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_scan,
 );
 
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_broadcast,
-        SHELL_CMD(list, NULL, "List scanned broadcasts.", broadcast_list),
+        SHELL_CMD(list, NULL, "List scanned broadcasts. `list json [cursor]` prints changed entries as JSON lines.", broadcast_list),
         SHELL_CMD(dump, NULL, "Dump Raw BIS PDUs and BIGInfo packets.", broadcast_dump),
+        SHELL_CMD(capture, NULL, "Capture profile for dump (full/lowload), shows radio load of the active dump.", broadcast_capture),
         SHELL_CMD(bisquit, NULL, "Run the bisquit attack against broadcast", broadcast_bisquit),
         SHELL_CMD(hijack, NULL, "Hijack broadcast", broadcast_hijack),
         SHELL_SUBCMD_SET_END
@@ -150,4 +149,8 @@ SHELL_CMD_REGISTER(scan, &sub_scan, "Scan for Auracast Broadcasts", NULL);
 SHELL_CMD_REGISTER(broadcast, &sub_broadcast, "Broadcast commands", NULL);
 SHELL_CMD_REGISTER(debug, &sub_debug, "Debug Options (on/off)", debug_handler);
 
-int main(void) {}
\ No newline at end of file
+int main(void) {
+	/* debug messages are compiled in, but only emitted after `debug on` */
+	debug_set(false);
+	return 0;
+}
\ No newline at end of file
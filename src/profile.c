@@ -0,0 +1,201 @@
+#include "auracast_hackers_toolkit.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+
+/* log2 buckets of the callback run time in ns, the last bucket collects everything above. The run
+ * time comes from the timing API (the DWT cycle counter on Cortex-M), k_cycle_get_32() ticks at
+ * 32.768 kHz on nRF and can't resolve a callback. */
+#define PROFILE_HIST_BUCKETS    24
+
+struct profile_hist {
+	uint32_t count;
+	uint32_t max;
+	uint64_t total;
+	uint32_t buckets[PROFILE_HIST_BUCKETS];
+};
+
+struct profile_pool {
+	struct net_buf_pool *pool;
+	atomic_val_t min_free;
+};
+
+static const char *const probe_names[PROFILE_PROBE_COUNT] = {
+	[PROFILE_ISO_RAW_DUMP] = "iso_raw_dump_cb",
+	[PROFILE_SCAN_RAW_BIGINFO] = "scan_raw_get_biginfo_cb",
+	[PROFILE_SCAN_RECV] = "broadcast_scan_recv",
+	[PROFILE_PA_RECV] = "recv_cb",
+	[PROFILE_PA_BIGINFO] = "biginfo_cb",
+	[PROFILE_ISO_RECV] = "iso_recv",
+};
+
+/* The probes run in the Bluetooth RX context, the lock keeps `profile reset` from clearing the
+ * statistics in the middle of an update. */
+static struct profile_hist hists[PROFILE_PROBE_COUNT];
+static struct profile_pool pools[CONFIG_AHT_PROFILE_MAX_POOLS];
+static struct k_spinlock profile_lock;
+
+void profile_record(enum profile_probe probe, timing_t start) {
+	timing_t end = timing_counter_get();
+	uint64_t ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+	uint32_t t = MIN(ns, UINT32_MAX);
+	struct profile_hist *h = &hists[probe];
+	uint8_t bucket = t ? MIN(32 - __builtin_clz(t), PROFILE_HIST_BUCKETS - 1) : 0;
+	k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+	h->count++;
+	h->total += t;
+	h->max = MAX(h->max, t);
+	h->buckets[bucket]++;
+
+	k_spin_unlock(&profile_lock, key);
+}
+
+void profile_net_buf(struct net_buf *buf) {
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+	atomic_val_t avail = atomic_get(&pool->avail_count);
+	k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+	for (int i = 0; i < ARRAY_SIZE(pools); i++) {
+		struct profile_pool *p = &pools[i];
+
+		if (p->pool == NULL) {
+			p->pool = pool;
+			p->min_free = avail;
+			break;
+		}
+
+		if (p->pool == pool) {
+			p->min_free = MIN(p->min_free, avail);
+			break;
+		}
+	}
+
+	k_spin_unlock(&profile_lock, key);
+}
+
+static void profile_thread_cb(const struct k_thread *cthread, void *user_data) {
+	const struct shell *sh = user_data;
+	struct k_thread *thread = (struct k_thread *)cthread;
+	k_thread_runtime_stats_t rt = {0};
+	k_thread_runtime_stats_t all = {0};
+	const char *name = k_thread_name_get(thread);
+	size_t size = thread->stack_info.size;
+	size_t unused = 0;
+	uint32_t cpu_permille = 0;
+
+	k_thread_stack_space_get(thread, &unused);
+	k_thread_runtime_stats_get(thread, &rt);
+	k_thread_runtime_stats_all_get(&all);
+
+	if (all.execution_cycles > 0) {
+		cpu_permille = (rt.execution_cycles * 1000U) / all.execution_cycles;
+	}
+
+	shell_print(sh, "  %-20s stack %5zu/%5zu used (%2zu%%), cpu %3u.%u%%",
+		    name ? name : "unnamed", size - unused, size,
+		    size ? ((size - unused) * 100U) / size : 0,
+		    cpu_permille / 10, cpu_permille % 10);
+}
+
+static int profile_threads(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "Threads (stack high-water mark, CPU usage since boot):");
+	k_thread_foreach_unlocked(profile_thread_cb, (void *)sh);
+
+	return 0;
+}
+
+static int profile_callbacks(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "Callbacks (run time in ns, timer at %u MHz):", timing_freq_get_mhz());
+
+	for (int i = 0; i < PROFILE_PROBE_COUNT; i++) {
+		struct profile_hist *h = &hists[i];
+
+		if (h->count == 0) {
+			continue;
+		}
+
+		shell_print(sh, "  %-24s count %u, avg %llu, max %u", probe_names[i], h->count,
+			    h->total / h->count, h->max);
+
+		for (int b = 0; b < PROFILE_HIST_BUCKETS; b++) {
+			if (h->buckets[b] == 0) {
+				continue;
+			}
+			if (b == PROFILE_HIST_BUCKETS - 1) {
+				shell_print(sh, "    >= %10u: %u", (uint32_t)BIT(b - 1), h->buckets[b]);
+			} else {
+				shell_print(sh, "    <  %10u: %u", (uint32_t)BIT(b), h->buckets[b]);
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int profile_pools(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "net_buf pools (minimum free buffers seen in callbacks):");
+
+	for (int i = 0; i < ARRAY_SIZE(pools); i++) {
+		struct profile_pool *p = &pools[i];
+
+		if (p->pool == NULL) {
+			break;
+		}
+
+		shell_print(sh, "  %-20s min free %ld/%u, now %ld", p->pool->name, (long)p->min_free,
+			    p->pool->pool_size, (long)atomic_get(&p->pool->avail_count));
+	}
+
+	return 0;
+}
+
+static int profile_reset(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	k_spinlock_key_t key = k_spin_lock(&profile_lock);
+	memset(hists, 0x00, sizeof(hists));
+	memset(pools, 0x00, sizeof(pools));
+	k_spin_unlock(&profile_lock, key);
+
+	shell_print(sh, "Callback histograms and pool statistics reset");
+
+	return 0;
+}
+
+static int profile_handler(const struct shell *sh, size_t argc, char **argv) {
+	profile_threads(sh, argc, argv);
+	profile_callbacks(sh, argc, argv);
+	profile_pools(sh, argc, argv);
+
+	return 0;
+}
+
+static int profile_init(void) {
+	timing_init();
+	timing_start();
+
+	return 0;
+}
+
+SYS_INIT(profile_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_profile,
+        SHELL_CMD(threads, NULL, "Stack high-water marks and CPU usage per thread.", profile_threads),
+        SHELL_CMD(callbacks, NULL, "Run time histograms of the Bluetooth callbacks.", profile_callbacks),
+        SHELL_CMD(pools, NULL, "Minimum free buffers of the net_buf pools.", profile_pools),
+        SHELL_CMD(reset, NULL, "Reset callback histograms and pool statistics.", profile_reset),
+        SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(profile, &sub_profile, "Runtime profiling (threads/callbacks/pools/reset)", profile_handler);
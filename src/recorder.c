@@ -0,0 +1,324 @@
+#include "auracast_hackers_toolkit.h"
+
+#include <zephyr/kernel.h>
+
+/* Flight recorder for the raw dump. While enabled, records are kept in a RAM ring buffer in the
+ * binary capture format instead of being printed, the oldest ones are discarded once the buffer,
+ * the PDU limit or the time window is exceeded. A trigger freezes the ring and prints it from a low
+ * priority work queue of its own in the usual dump format, framed by FLIGHTREC lines. Printing a
+ * full ring takes seconds on a UART, the system work queue (and the BIG resync on it) must not wait
+ * for that.
+ *
+ * The raw dump doesn't tell which BIS a PDU belongs to, so the ring is shared by all BISes of the
+ * BIG and the PDU limit is per BIS times the number of BISes, taken from the latest BIGInfo. */
+
+LOG_MODULE_REGISTER(aht_recorder, CONFIG_AHT_LOG_LEVEL);
+
+#define BIGINFO_MAX_LEN     57
+
+static uint8_t ring[CONFIG_AHT_RECORDER_BUF_SIZE];
+static size_t ring_tail;
+static size_t ring_used;
+static uint32_t ring_records;
+static uint32_t ring_pdus;
+static struct k_spinlock recorder_lock;
+
+static bool recorder_active;
+static bool recorder_frozen;
+static bool auto_trigger;
+static uint32_t pdus_per_bis;
+static uint32_t max_pdus;
+static uint32_t max_age_ms;
+static const char *trigger_reason;
+
+static uint8_t last_biginfo[BIGINFO_MAX_LEN];
+static uint8_t last_biginfo_len;
+
+static uint32_t triggers;
+static uint32_t dropped_while_frozen;
+
+static void recorder_flush_fn(struct k_work *work);
+static K_WORK_DEFINE(recorder_flush_work, recorder_flush_fn);
+static K_THREAD_STACK_DEFINE(recorder_wq_stack, CONFIG_AHT_RECORDER_STACK_SIZE);
+static struct k_work_q recorder_wq;
+static bool recorder_wq_started;
+
+static void ring_read(size_t pos, void *out, size_t len) {
+	size_t first = MIN(len, sizeof(ring) - pos);
+
+	memcpy(out, &ring[pos], first);
+	memcpy((uint8_t *)out + first, ring, len - first);
+}
+
+static void ring_write(size_t pos, const void *in, size_t len) {
+	size_t first = MIN(len, sizeof(ring) - pos);
+
+	memcpy(&ring[pos], in, first);
+	memcpy(ring, (const uint8_t *)in + first, len - first);
+}
+
+/* must be called with recorder_lock held */
+static void ring_drop_oldest(void) {
+	struct capture_record_hdr hdr;
+
+	ring_read(ring_tail, &hdr, sizeof(hdr));
+	ring_tail = (ring_tail + sizeof(hdr) + hdr.len) % sizeof(ring);
+	ring_used -= sizeof(hdr) + hdr.len;
+	ring_records--;
+	if (hdr.type == CAPTURE_RECORD_PDU) {
+		ring_pdus--;
+	}
+}
+
+static uint32_t ring_oldest_timestamp(void) {
+	struct capture_record_hdr hdr;
+
+	ring_read(ring_tail, &hdr, sizeof(hdr));
+
+	return sys_le32_to_cpu(hdr.timestamp_ms);
+}
+
+/* Only the parts of the BIGInfo that don't change every event: skip the BIG offset, its units
+ * (bit 14, both follow the distance to the next BIG event) and the payload counter, but keep the
+ * first ISO interval bit and the framing bit. Same as biginfo_key() in scripts/capture_index.py. */
+static bool biginfo_changed(const uint8_t *data, uint8_t len) {
+	bool changed = false;
+
+	if (last_biginfo_len > 0) {
+		changed = len != last_biginfo_len ||
+			  (data[1] & 0x80) != (last_biginfo[1] & 0x80) ||
+			  memcmp(&data[2], &last_biginfo[2], 28 - 2) != 0 ||
+			  (data[32] & 0x80) != (last_biginfo[32] & 0x80) ||
+			  memcmp(&data[33], &last_biginfo[33], len - MIN(len, 33)) != 0;
+	}
+
+	memcpy(last_biginfo, data, len);
+	last_biginfo_len = len;
+
+	return changed;
+}
+
+bool recorder_is_active(void) {
+	return recorder_active;
+}
+
+void recorder_trigger(const char *reason) {
+	k_spinlock_key_t key = k_spin_lock(&recorder_lock);
+	bool triggered = false;
+
+	if (recorder_active && !recorder_frozen) {
+		recorder_frozen = true;
+		trigger_reason = reason;
+		triggers++;
+		triggered = true;
+		k_work_submit_to_queue(&recorder_wq, &recorder_flush_work);
+	}
+
+	k_spin_unlock(&recorder_lock, key);
+
+	if (triggered) {
+		LOG_DBG("Triggered (%s) with %u records, %u PDUs", reason, ring_records, ring_pdus);
+	} else {
+		LOG_DBG("Trigger (%s) ignored, recorder %s", reason, recorder_active ? "flushing" : "off");
+	}
+}
+
+bool recorder_record(uint8_t type, uint64_t payload_number, const uint8_t *data, uint8_t len) {
+	struct capture_record_hdr hdr = {
+		.type = type,
+		.len = len,
+		.timestamp_ms = sys_cpu_to_le32(k_uptime_get_32()),
+		.payload_number = sys_cpu_to_le64(payload_number),
+	};
+	const char *reason = NULL;
+	size_t size = sizeof(hdr) + len;
+	k_spinlock_key_t key;
+
+	if (!recorder_active) {
+		return false;
+	}
+
+	if (type == CAPTURE_RECORD_BIGINFO && len >= 33 && len <= BIGINFO_MAX_LEN) {
+		bool encrypted = last_biginfo_len >= BIGINFO_MAX_LEN;
+
+		if (biginfo_changed(data, len) && auto_trigger) {
+			reason = encrypted != (len >= BIGINFO_MAX_LEN) ? "encryption changed" : "BIGInfo changed";
+		}
+	}
+
+	key = k_spin_lock(&recorder_lock);
+
+	/* the BIG may only become known after `recorder on`, size the PDU limit from its BIGInfo */
+	if (type == CAPTURE_RECORD_BIGINFO && len >= 4) {
+		max_pdus = pdus_per_bis * MAX(PDU_BIG_INFO_NUM_BIS_GET((uint8_t *)data), 1);
+	}
+
+	if (recorder_frozen) {
+		dropped_while_frozen++;
+	} else if (size <= sizeof(ring)) {
+		while (ring_used + size > sizeof(ring) ||
+		       (type == CAPTURE_RECORD_PDU && max_pdus > 0 && ring_pdus >= max_pdus)) {
+			ring_drop_oldest();
+		}
+		while (max_age_ms > 0 && ring_records > 0 &&
+		       k_uptime_get_32() - ring_oldest_timestamp() > max_age_ms) {
+			ring_drop_oldest();
+		}
+
+		ring_write((ring_tail + ring_used) % sizeof(ring), &hdr, sizeof(hdr));
+		ring_write((ring_tail + ring_used + sizeof(hdr)) % sizeof(ring), data, len);
+		ring_used += size;
+		ring_records++;
+		if (type == CAPTURE_RECORD_PDU) {
+			ring_pdus++;
+		}
+	}
+
+	k_spin_unlock(&recorder_lock, key);
+
+	/* the record that caused the trigger is part of the snapshot */
+	if (reason != NULL) {
+		recorder_trigger(reason);
+	}
+
+	return true;
+}
+
+static void recorder_flush_fn(struct k_work *work) {
+	/* static to keep the work queue stack small, flushes never run concurrently */
+	static uint8_t data[UINT8_MAX];
+	static char hexout[256 * 2];
+	struct capture_record_hdr hdr;
+	size_t pos = ring_tail;
+	uint32_t first_ts = 0;
+	uint32_t last_ts = 0;
+
+	/* the ring is frozen, nothing else touches it until we're done */
+	if (ring_records > 0) {
+		first_ts = ring_oldest_timestamp();
+	}
+
+	printk("FLIGHTREC BEGIN reason=%s records=%u\r\n", trigger_reason, ring_records);
+
+	for (uint32_t i = 0; i < ring_records; i++) {
+		ring_read(pos, &hdr, sizeof(hdr));
+		ring_read((pos + sizeof(hdr)) % sizeof(ring), data, hdr.len);
+		pos = (pos + sizeof(hdr) + hdr.len) % sizeof(ring);
+		last_ts = sys_le32_to_cpu(hdr.timestamp_ms);
+
+		bin2hex(data, hdr.len, hexout, sizeof(hexout));
+		if (hdr.type == CAPTURE_RECORD_PDU) {
+			printk("PDU %lld,%d,%s\r\n", sys_le64_to_cpu(hdr.payload_number), hdr.len, hexout);
+		} else {
+			printk("BIGInfo %d,%s\r\n", hdr.len, hexout);
+		}
+	}
+
+	printk("FLIGHTREC END span_ms=%u\r\n", last_ts - first_ts);
+
+	k_spinlock_key_t key = k_spin_lock(&recorder_lock);
+	ring_tail = 0;
+	ring_used = 0;
+	ring_records = 0;
+	ring_pdus = 0;
+	recorder_frozen = false;
+	k_spin_unlock(&recorder_lock, key);
+}
+
+static int recorder_on(const struct shell *sh, size_t argc, char **argv) {
+	struct broadcast *b = get_active_broadcast();
+	uint32_t per_bis = 0;
+	uint8_t num_bis = (b && b->has_biginfo) ? b->biginfo.num_bis : 1;
+
+	max_age_ms = 0;
+	auto_trigger = true;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "pdus") == 0 && i + 1 < argc) {
+			per_bis = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "seconds") == 0 && i + 1 < argc) {
+			max_age_ms = strtoul(argv[++i], NULL, 10) * MSEC_PER_SEC;
+		} else if (strcmp(argv[i], "manual") == 0) {
+			auto_trigger = false;
+		} else {
+			shell_error(sh, "Unknown option %s", argv[i]);
+			return 1;
+		}
+	}
+
+	if (!recorder_wq_started) {
+		k_work_queue_start(&recorder_wq, recorder_wq_stack, K_THREAD_STACK_SIZEOF(recorder_wq_stack),
+				   K_LOWEST_APPLICATION_THREAD_PRIO, &(struct k_work_queue_config){.name = "aht_recorder"});
+		recorder_wq_started = true;
+	}
+
+	/* a flush of the previous session may still be reading the frozen ring */
+	k_work_flush(&recorder_flush_work, &(struct k_work_sync){0});
+
+	k_spinlock_key_t key = k_spin_lock(&recorder_lock);
+	ring_tail = 0;
+	ring_used = 0;
+	ring_records = 0;
+	ring_pdus = 0;
+	pdus_per_bis = per_bis;
+	max_pdus = per_bis * MAX(num_bis, 1);
+	last_biginfo_len = 0;
+	triggers = 0;
+	dropped_while_frozen = 0;
+	recorder_frozen = false;
+	recorder_active = true;
+	k_spin_unlock(&recorder_lock, key);
+
+	shell_info(sh, "Flight recorder on: %u byte buffer, %u PDUs per BIS, %u s window, %s triggers",
+		   CONFIG_AHT_RECORDER_BUF_SIZE, per_bis, max_age_ms / MSEC_PER_SEC,
+		   auto_trigger ? "automatic and manual" : "manual");
+
+	return 0;
+}
+
+static int recorder_off(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	recorder_active = false;
+	k_work_flush(&recorder_flush_work, &(struct k_work_sync){0});
+	shell_info(sh, "Flight recorder off, dump output goes to the console again");
+
+	return 0;
+}
+
+static int recorder_trigger_cmd(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!recorder_active) {
+		shell_error(sh, "Flight recorder is off, enable it with `recorder on`");
+		return 1;
+	}
+
+	recorder_trigger("manual");
+
+	return 0;
+}
+
+static int recorder_status(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "Flight recorder %s%s: %u records (%u PDUs), %zu/%u bytes used",
+		    recorder_active ? "on" : "off", recorder_frozen ? " (flushing)" : "",
+		    ring_records, ring_pdus, ring_used, CONFIG_AHT_RECORDER_BUF_SIZE);
+	shell_print(sh, "%u triggers, %u records dropped while flushing", triggers, dropped_while_frozen);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_recorder,
+        SHELL_CMD(on, NULL, "Keep the dump in RAM: on [pdus <per BIS>] [seconds <window>] [manual]", recorder_on),
+        SHELL_CMD(off, NULL, "Stop recording, print the dump again.", recorder_off),
+        SHELL_CMD(trigger, NULL, "Print the recorded snapshot now.", recorder_trigger_cmd),
+        SHELL_CMD(status, NULL, "Show buffer usage and trigger counts.", recorder_status),
+        SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(recorder, &sub_recorder, "Flight recorder for broadcast dump", recorder_status);
@@ -0,0 +1,486 @@
+#include "auracast_hackers_toolkit.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+
+/* Replays a capture as synthetic raw ISO dump events. A reader thread parses the capture and hands
+ * the events to an RX thread that calls the dump callback the same way the Bluetooth RX thread
+ * does. In realtime mode every event gets a deadline on the host wall clock, paced like the
+ * original broadcast, in max mode the run measures the ceiling.
+ *
+ * On native_sim code runs in zero simulated time, so the reader can never interrupt a slow
+ * callback and the FIFO never overflows by itself. Drops are therefore modelled in the RX thread:
+ * an event is dropped if, at its deadline, the previous CONFIG_AHT_REPLAY_BUF_COUNT accepted events
+ * were still not finished, i.e. the controller would have found no free buffer. */
+
+LOG_MODULE_REGISTER(aht_replay, CONFIG_AHT_LOG_LEVEL);
+
+#define REPLAY_LINE_MAX     600
+/* events submitted later than this count as late (about one ISO interval) */
+#define REPLAY_LATE_US      10000
+#define REPLAY_READER_PRIO  K_PRIO_PREEMPT(0)
+#define REPLAY_RX_PRIO      K_PRIO_PREEMPT(1)
+
+#if defined(CONFIG_ARCH_POSIX)
+/* provided by replay_native.c, which is built against the host libc */
+uint64_t replay_host_time_us(void);
+#define replay_time_us()    replay_host_time_us()
+#else
+#define replay_time_us()    k_ticks_to_us_floor64(k_uptime_ticks())
+#endif
+
+NET_BUF_POOL_DEFINE(replay_pool, CONFIG_AHT_REPLAY_BUF_COUNT,
+		    sizeof(struct bt_hci_evt_iso_raw_dump) + UINT8_MAX, sizeof(uint64_t), NULL);
+
+static K_FIFO_DEFINE(replay_fifo);
+static K_THREAD_STACK_DEFINE(replay_reader_stack, CONFIG_AHT_REPLAY_STACK_SIZE);
+static K_THREAD_STACK_DEFINE(replay_rx_stack, CONFIG_AHT_REPLAY_STACK_SIZE);
+static struct k_thread replay_reader_thread;
+static struct k_thread replay_rx_thread;
+static bool replay_rx_started;
+
+struct replay_reader {
+	struct fs_file_t file;
+	uint8_t buf[CONFIG_AHT_REPLAY_READ_BUF_SIZE];
+	size_t len;
+	size_t pos;
+};
+
+struct replay_stats {
+	uint32_t pdus;
+	uint32_t biginfos;
+	uint32_t drops;
+	uint32_t parse_errors;
+	uint32_t late;
+	uint64_t max_lag_us;
+	uint64_t start_us;
+	uint64_t end_us;
+};
+
+static struct replay_reader reader;
+static struct replay_stats stats;
+static struct {
+	bool valid;
+	uint64_t first_us;
+	uint64_t last_us;
+	uint64_t base_us;
+} pace;
+/* host time at which the last accepted events finished, oldest at done_idx */
+static uint64_t done_us[CONFIG_AHT_REPLAY_BUF_COUNT];
+static uint32_t done_idx;
+static char replay_path[64];
+static bool replay_realtime;
+static void (*replay_cb)(struct net_buf *buf);
+static atomic_t replay_running;
+static atomic_t replay_stop_req;
+static atomic_t replay_in_flight;
+
+static int reader_fill(struct replay_reader *r) {
+	ssize_t n;
+
+	if (r->pos < r->len) {
+		memmove(r->buf, &r->buf[r->pos], r->len - r->pos);
+	}
+	r->len -= r->pos;
+	r->pos = 0;
+
+	n = fs_read(&r->file, &r->buf[r->len], sizeof(r->buf) - r->len);
+	if (n < 0) {
+		return n;
+	}
+	r->len += n;
+
+	return n;
+}
+
+/* Read exactly `len` bytes. Returns 0 at the end of the file. */
+static int reader_read(struct replay_reader *r, void *out, size_t len) {
+	while (r->len - r->pos < len) {
+		int err = reader_fill(r);
+
+		if (err <= 0) {
+			return err;
+		}
+	}
+
+	memcpy(out, &r->buf[r->pos], len);
+	r->pos += len;
+
+	return len;
+}
+
+/* Read one line without the line ending, overlong lines are truncated. Returns -ENODATA at the end
+ * of the file, otherwise the line length. */
+static int reader_getline(struct replay_reader *r, char *line, size_t max) {
+	size_t len = 0;
+
+	while (true) {
+		if (r->pos == r->len) {
+			int err = reader_fill(r);
+
+			if (err < 0) {
+				return err;
+			}
+			if (err == 0) {
+				break;
+			}
+		}
+
+		char c = r->buf[r->pos++];
+
+		if (c == '\n') {
+			break;
+		}
+		if (c != '\r' && len < max - 1) {
+			line[len++] = c;
+		}
+	}
+
+	line[len] = '\0';
+
+	if (len == 0 && r->pos == r->len) {
+		return -ENODATA;
+	}
+
+	return len;
+}
+
+/* Hand one event with its host deadline `due_us` (0 in max mode) to the RX thread. Returns false if
+ * the replay was stopped. */
+static bool replay_submit(uint8_t type, uint64_t payload_number, const uint8_t *data, uint8_t len,
+			  uint64_t due_us) {
+	struct bt_hci_evt_iso_raw_dump *evt;
+	struct net_buf *buf;
+
+	do {
+		if (atomic_get(&replay_stop_req)) {
+			return false;
+		}
+		buf = net_buf_alloc(&replay_pool, K_MSEC(100));
+	} while (buf == NULL);
+
+	*(uint64_t *)net_buf_user_data(buf) = due_us;
+	evt = net_buf_add(buf, sizeof(*evt));
+	memset(evt, 0x00, sizeof(*evt));
+	evt->type = type;
+	evt->len = len;
+	evt->payload_number = payload_number;
+	net_buf_add_mem(buf, data, len);
+
+	atomic_inc(&replay_in_flight);
+	k_fifo_put(&replay_fifo, buf);
+
+	return true;
+}
+
+/* Wait until the capture position `pos_us` is due on the host clock and return the deadline. The
+ * capture clock is re-based whenever it jumps ahead by more than a second or goes backwards (gaps,
+ * resyncs or a new dump in the same log). Falling behind is never re-based away, the RX thread
+ * counts it as lag. */
+static uint64_t replay_pace(uint64_t pos_us) {
+	uint64_t now = replay_time_us();
+	uint64_t due;
+
+	if (!replay_realtime) {
+		return 0;
+	}
+
+	if (!pace.valid) {
+		pace.first_us = pos_us;
+		pace.base_us = now;
+		pace.valid = true;
+	} else if (pos_us < pace.last_us || pos_us - pace.last_us > USEC_PER_SEC) {
+		/* continue right after the previous event, keeping any lag */
+		pace.base_us += pace.last_us - pace.first_us;
+		pace.first_us = pos_us;
+	}
+	pace.last_us = pos_us;
+	due = pace.base_us + pos_us - pace.first_us;
+
+	/* k_usleep() sleeps in simulated time, check against the host clock until it is due */
+	while (now < due && !atomic_get(&replay_stop_req)) {
+		k_usleep(due - now);
+		now = replay_time_us();
+	}
+
+	return due;
+}
+
+static void replay_text(void) {
+	static char line[REPLAY_LINE_MAX];
+	uint8_t data[UINT8_MAX];
+	uint32_t pn_step_us = 0;
+	uint64_t due = 0;
+	int len;
+
+	while ((len = reader_getline(&reader, line, sizeof(line))) >= 0) {
+		uint64_t pn = 0;
+		uint8_t type;
+		unsigned long data_len;
+		char *p;
+
+		if (strncmp(line, "PDU ", 4) == 0) {
+			type = BT_HCI_EVT_ISO_RAW_DUMP_PDU;
+			pn = strtoull(&line[4], &p, 10);
+			if (*p++ != ',') {
+				LOG_DBG("Malformed PDU line");
+				stats.parse_errors++;
+				continue;
+			}
+		} else if (strncmp(line, "BIGInfo ", 8) == 0) {
+			type = BT_HCI_EVT_ISO_RAW_DUMP_BIG;
+			p = &line[8];
+		} else {
+			/* shell output and other noise in the log */
+			continue;
+		}
+
+		data_len = strtoul(p, &p, 10);
+		if (*p++ != ',' || data_len > sizeof(data) ||
+		    hex2bin(p, strlen(p), data, sizeof(data)) != data_len) {
+			LOG_DBG("Malformed %s data", type == BT_HCI_EVT_ISO_RAW_DUMP_PDU ? "PDU" : "BIGInfo");
+			stats.parse_errors++;
+			continue;
+		}
+
+		if (type == BT_HCI_EVT_ISO_RAW_DUMP_BIG && data_len >= 5) {
+			uint32_t bn = PDU_BIG_INFO_BN_GET(data);
+			/* ISO interval is in 1.25 ms units, every interval carries BN payload numbers */
+			pn_step_us = (PDU_BIG_INFO_ISO_INTERVAL_GET(data) * 1250U) / MAX(bn, 1);
+		}
+
+		/* the text format has no timestamps, derive them from the payload number */
+		if (type == BT_HCI_EVT_ISO_RAW_DUMP_PDU && pn_step_us > 0) {
+			due = replay_pace(pn * pn_step_us);
+		}
+
+		if (!replay_submit(type, pn, data, data_len, due)) {
+			return;
+		}
+	}
+}
+
+static void replay_binary(void) {
+	struct capture_record_hdr hdr;
+	uint8_t data[UINT8_MAX];
+	uint64_t due;
+
+	while (reader_read(&reader, &hdr, sizeof(hdr)) == sizeof(hdr)) {
+		if (reader_read(&reader, data, hdr.len) != hdr.len) {
+			LOG_DBG("Truncated record of %u bytes", hdr.len);
+			stats.parse_errors++;
+			return;
+		}
+
+		if (hdr.type == CAPTURE_RECORD_PAD) {
+			continue;
+		}
+		if (hdr.type != CAPTURE_RECORD_PDU && hdr.type != CAPTURE_RECORD_BIGINFO) {
+			LOG_DBG("Unknown record type 0x%02x", hdr.type);
+			stats.parse_errors++;
+			continue;
+		}
+
+		due = replay_pace((uint64_t)sys_le32_to_cpu(hdr.timestamp_ms) * USEC_PER_MSEC);
+
+		if (!replay_submit(hdr.type == CAPTURE_RECORD_PDU ? BT_HCI_EVT_ISO_RAW_DUMP_PDU : BT_HCI_EVT_ISO_RAW_DUMP_BIG,
+				   sys_le64_to_cpu(hdr.payload_number), data, hdr.len, due)) {
+			return;
+		}
+	}
+}
+
+static void replay_print_stats(const struct shell *sh) {
+	uint64_t end = atomic_get(&replay_running) ? replay_time_us() : stats.end_us;
+	uint64_t elapsed_us = end - stats.start_us;
+
+	shell_print(sh, "Replay of %s (%s): %u PDUs, %u BIGInfos, %u dropped, %u parse errors",
+		    replay_path, replay_realtime ? "realtime" : "max speed", stats.pdus, stats.biginfos,
+		    stats.drops, stats.parse_errors);
+	if (elapsed_us > 0) {
+		shell_print(sh, "Elapsed %llu ms, %llu PDUs/s", elapsed_us / USEC_PER_MSEC,
+			    ((uint64_t)stats.pdus * USEC_PER_SEC) / elapsed_us);
+	}
+	if (replay_realtime) {
+		shell_print(sh, "%u events more than %u ms late, max lag %llu ms%s", stats.late,
+			    REPLAY_LATE_US / USEC_PER_MSEC, stats.max_lag_us / USEC_PER_MSEC,
+			    stats.drops > 0 || stats.late > 0 ? ": the pipeline can't keep up" : "");
+	}
+}
+
+static void replay_reader_fn(void *p1, void *p2, void *p3) {
+	const struct shell *sh = p1;
+	char magic[CAPTURE_FILE_MAGIC_LEN];
+
+	stats.start_us = replay_time_us();
+
+	if (reader_read(&reader, magic, sizeof(magic)) == sizeof(magic) &&
+	    memcmp(magic, CAPTURE_FILE_MAGIC, sizeof(magic)) == 0) {
+		replay_binary();
+	} else {
+		/* not a binary capture, start over as text log */
+		fs_seek(&reader.file, 0, FS_SEEK_SET);
+		reader.len = 0;
+		reader.pos = 0;
+		replay_text();
+	}
+
+	/* wait for the RX thread to drain so the numbers cover the whole pipeline */
+	while (atomic_get(&replay_in_flight) > 0) {
+		k_sleep(K_MSEC(1));
+	}
+
+	stats.end_us = replay_time_us();
+	fs_close(&reader.file);
+	atomic_clear(&replay_running);
+
+	replay_print_stats(sh);
+}
+
+/* Account for the deadline of an event before its callback runs. Returns false if the event would
+ * have been dropped for lack of a free buffer. */
+static bool replay_rx_due(uint64_t due) {
+	uint64_t now = replay_time_us();
+
+	if (due == 0) {
+		return true;
+	}
+
+	/* every buffer still belonged to an unfinished event when this one arrived */
+	if (done_us[done_idx] > due) {
+		stats.drops++;
+		return false;
+	}
+
+	if (now > due) {
+		stats.max_lag_us = MAX(stats.max_lag_us, now - due);
+		if (now - due > REPLAY_LATE_US) {
+			stats.late++;
+		}
+	}
+
+	return true;
+}
+
+static void replay_rx_fn(void *p1, void *p2, void *p3) {
+	while (true) {
+		struct net_buf *buf = k_fifo_get(&replay_fifo, K_FOREVER);
+		struct bt_hci_evt_iso_raw_dump *evt = (void *)buf->data;
+		uint64_t due = *(uint64_t *)net_buf_user_data(buf);
+
+		if (replay_rx_due(due)) {
+			if (evt->type == BT_HCI_EVT_ISO_RAW_DUMP_PDU) {
+				stats.pdus++;
+			} else {
+				stats.biginfos++;
+			}
+
+			replay_cb(buf);
+
+			done_us[done_idx] = replay_time_us();
+			done_idx = (done_idx + 1) % ARRAY_SIZE(done_us);
+		} else {
+			LOG_DBG("No buffer left, dropping %s %llu",
+				evt->type == BT_HCI_EVT_ISO_RAW_DUMP_PDU ? "PDU" : "BIGInfo", evt->payload_number);
+		}
+
+		net_buf_unref(buf);
+		atomic_dec(&replay_in_flight);
+	}
+}
+
+static int replay_start(const struct shell *sh, size_t argc, char **argv) {
+	int err;
+
+	if (atomic_get(&replay_running)) {
+		shell_error(sh, "Replay of %s is still running, stop it with `replay stop`", replay_path);
+		return 1;
+	}
+
+	replay_realtime = true;
+	replay_cb = iso_raw_dump_cb;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "max") == 0) {
+			replay_realtime = false;
+		} else if (strcmp(argv[i], "realtime") == 0) {
+			replay_realtime = true;
+		} else if (strcmp(argv[i], "biginfo") == 0) {
+			replay_cb = scan_raw_get_biginfo_cb;
+		} else {
+			shell_error(sh, "Unknown option %s", argv[i]);
+			return 1;
+		}
+	}
+
+	strncpy(replay_path, argv[1], sizeof(replay_path) - 1);
+	fs_file_t_init(&reader.file);
+	err = fs_open(&reader.file, replay_path, FS_O_READ);
+	if (err) {
+		shell_error(sh, "Error opening %s: %d", replay_path, err);
+		return 1;
+	}
+
+	reader.len = 0;
+	reader.pos = 0;
+	memset(&stats, 0x00, sizeof(stats));
+	memset(&pace, 0x00, sizeof(pace));
+	memset(done_us, 0x00, sizeof(done_us));
+	done_idx = 0;
+	atomic_clear(&replay_stop_req);
+	atomic_set(&replay_running, 1);
+
+	if (!replay_rx_started) {
+		k_thread_create(&replay_rx_thread, replay_rx_stack, K_THREAD_STACK_SIZEOF(replay_rx_stack),
+				replay_rx_fn, NULL, NULL, NULL, REPLAY_RX_PRIO, 0, K_NO_WAIT);
+		k_thread_name_set(&replay_rx_thread, "replay_rx");
+		replay_rx_started = true;
+	}
+
+	k_thread_create(&replay_reader_thread, replay_reader_stack, K_THREAD_STACK_SIZEOF(replay_reader_stack),
+			replay_reader_fn, (void *)sh, NULL, NULL, REPLAY_READER_PRIO, 0, K_NO_WAIT);
+	k_thread_name_set(&replay_reader_thread, "replay_reader");
+
+	shell_info(sh, "Replaying %s at %s. Stop with `replay stop`!", replay_path,
+		   replay_realtime ? "realtime" : "max speed");
+
+	return 0;
+}
+
+static int replay_stop(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!atomic_get(&replay_running)) {
+		shell_error(sh, "No replay running");
+		return 1;
+	}
+
+	atomic_set(&replay_stop_req, 1);
+	k_thread_join(&replay_reader_thread, K_FOREVER);
+
+	return 0;
+}
+
+static int replay_stats(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (stats.start_us == 0) {
+		shell_error(sh, "No replay has been run yet");
+		return 1;
+	}
+
+	replay_print_stats(sh);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_replay,
+        SHELL_CMD_ARG(start, NULL, "Replay a capture: start <file> [realtime|max] [biginfo]", replay_start, 2, 2),
+        SHELL_CMD(stop, NULL, "Stop the running replay.", replay_stop),
+        SHELL_CMD(stats, NULL, "Show replay throughput and drop counts.", replay_stats),
+        SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(replay, &sub_replay, "Replay captured logs through the dump callbacks", NULL);
@@ -0,0 +1,13 @@
+/* Host side of the replay clock for native_sim. This file is compiled against the host libc so the
+ * throughput numbers reflect wall-clock time instead of simulated time. */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t replay_host_time_us(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000U + ts.tv_nsec / 1000U;
+}
@@ -1,5 +1,7 @@
 #include "auracast_hackers_toolkit.h"
 
+LOG_MODULE_REGISTER(aht_scan, CONFIG_AHT_LOG_LEVEL);
+
 K_SEM_DEFINE(sem_biginfo, 0U, 1U);
 
 struct broadcast broadcasts[BROADCAST_LIST_MAX_LEN];
@@ -10,6 +12,9 @@ static uint32_t tmp_bis_spacing = 0;
 
 void scan_raw_get_biginfo_cb(struct net_buf *buf) {
 
+	PROFILE_START(PROFILE_SCAN_RAW_BIGINFO);
+	PROFILE_NET_BUF(buf);
+
 	struct bt_hci_evt_iso_raw_dump *evt = (void *)buf->data;
 	if (evt->type == BT_HCI_EVT_ISO_RAW_DUMP_BIG) {
         uint8_t *binfo = (buf->data + sizeof(*evt));
@@ -21,66 +26,73 @@ void scan_raw_get_biginfo_cb(struct net_buf *buf) {
 		tmp_bis_spacing = PDU_BIG_INFO_SPACING_GET(binfo);
 		k_sem_give(&sem_biginfo);
 	}
+
+	PROFILE_END(PROFILE_SCAN_RAW_BIGINFO);
 }
 
-int pa_sync_create(struct broadcast *b) {
-    uint32_t interval = BT_CONN_INTERVAL_TO_US(b->broadcaster_info.interval);
+int pa_sync_create(struct broadcast *b, uint16_t skip) {
 	struct bt_le_per_adv_sync_param create_params = {0};
 
 	bt_addr_le_copy(&create_params.addr, &b->broadcaster_addr);
 	create_params.options = 0;
 	create_params.sid = b->broadcaster_info.sid;
-	create_params.skip = 0;
-    // retry 5 times
-	create_params.timeout = (interval * 5) / (10 * USEC_PER_MSEC);
+	create_params.skip = skip;
+	create_params.timeout = interval_to_sync_timeout(b->broadcaster_info.interval, skip);
 
 	return bt_le_per_adv_sync_create(&create_params, &b->broadcast_sync);
 }
 
 static void sync_cb(struct bt_le_per_adv_sync *sync, struct bt_le_per_adv_sync_synced_info *info) {
-	char le_addr[BT_ADDR_LE_STR_LEN];
-
-	bt_addr_le_to_str(info->addr, le_addr, sizeof(le_addr));
-
-	debug_printk("PER_ADV_SYNC[%u]: [DEVICE]: %s synced, "
-	       "Interval 0x%04x (%u ms), PHY %s\n",
-	       bt_le_per_adv_sync_get_index(sync), le_addr,
+	LOG_DBG("PER_ADV_SYNC[%u]: [DEVICE]: " AHT_ADDR_LE_FMT " synced, "
+	       "Interval 0x%04x (%u ms), PHY %s",
+	       bt_le_per_adv_sync_get_index(sync), AHT_ADDR_LE_ARGS(info->addr),
 	       info->interval, info->interval * 5 / 4, phy2str(info->phy));
 }
 
 static void term_cb(struct bt_le_per_adv_sync *sync, const struct bt_le_per_adv_sync_term_info *info) {
-	char le_addr[BT_ADDR_LE_STR_LEN];
-
-	bt_addr_le_to_str(info->addr, le_addr, sizeof(le_addr));
-
-	debug_printk("PER_ADV_SYNC[%u]: [DEVICE]: %s sync terminated\n",
-	       bt_le_per_adv_sync_get_index(sync), le_addr);
+	LOG_DBG("PER_ADV_SYNC[%u]: [DEVICE]: " AHT_ADDR_LE_FMT " sync terminated",
+	       bt_le_per_adv_sync_get_index(sync), AHT_ADDR_LE_ARGS(info->addr));
 }
 
 static void recv_cb(struct bt_le_per_adv_sync *sync, const struct bt_le_per_adv_sync_recv_info *info, struct net_buf_simple *buf) {
-	char le_addr[BT_ADDR_LE_STR_LEN];
-	char data_str[129];
+	PROFILE_START(PROFILE_PA_RECV);
 
-	bt_addr_le_to_str(info->addr, le_addr, sizeof(le_addr));
-	bin2hex(buf->data, buf->len, data_str, sizeof(data_str));
+	LOG_DBG("PER_ADV_SYNC[%u]: [DEVICE]: " AHT_ADDR_LE_FMT ", tx_power %i, "
+	       "RSSI %i, CTE %u, data length %u",
+	       bt_le_per_adv_sync_get_index(sync), AHT_ADDR_LE_ARGS(info->addr), info->tx_power,
+	       info->rssi, info->cte_type, buf->len);
+	LOG_HEXDUMP_DBG(buf->data, buf->len, "data:");
 
-	debug_printk("PER_ADV_SYNC[%u]: [DEVICE]: %s, tx_power %i, "
-	       "RSSI %i, CTE %u, data length %u, data: %s\n",
-	       bt_le_per_adv_sync_get_index(sync), le_addr, info->tx_power,
-	       info->rssi, info->cte_type, buf->len, data_str);
+	PROFILE_END(PROFILE_PA_RECV);
 }
 
-static void biginfo_cb(struct bt_le_per_adv_sync *sync, const struct bt_iso_biginfo *biginfo) {
-	char le_addr[BT_ADDR_LE_STR_LEN];
+/* BIGInfo reports arrive with every PA event, only the static parameters count as a change
+ * (the addr pointer refers to the HCI event buffer and differs every time) */
+static bool biginfo_changed(const struct bt_iso_biginfo *a, const struct bt_iso_biginfo *b) {
+	return a->sid != b->sid ||
+	       a->num_bis != b->num_bis ||
+	       a->sub_evt_count != b->sub_evt_count ||
+	       a->iso_interval != b->iso_interval ||
+	       a->burst_number != b->burst_number ||
+	       a->offset != b->offset ||
+	       a->rep_count != b->rep_count ||
+	       a->max_pdu != b->max_pdu ||
+	       a->sdu_interval != b->sdu_interval ||
+	       a->max_sdu != b->max_sdu ||
+	       a->phy != b->phy ||
+	       a->framing != b->framing ||
+	       a->encryption != b->encryption;
+}
 
-	bt_addr_le_to_str(biginfo->addr, le_addr, sizeof(le_addr));
+static void biginfo_cb(struct bt_le_per_adv_sync *sync, const struct bt_iso_biginfo *biginfo) {
+	PROFILE_START(PROFILE_PA_BIGINFO);
 
-	debug_printk("BIG INFO[%u]: [DEVICE]: %s, sid 0x%02x, "
+	LOG_DBG("BIG INFO[%u]: [DEVICE]: " AHT_ADDR_LE_FMT ", sid 0x%02x, "
 	       "num_bis %u, nse %u, interval 0x%04x (%u ms), "
 	       "bn %u, pto %u, irc %u, max_pdu %u, "
 	       "sdu_interval %u us, max_sdu %u, phy %s, "
-	       "%s framing, %sencrypted\n",
-	       bt_le_per_adv_sync_get_index(sync), le_addr, biginfo->sid,
+	       "%s framing, %sencrypted",
+	       bt_le_per_adv_sync_get_index(sync), AHT_ADDR_LE_ARGS(biginfo->addr), biginfo->sid,
 	       biginfo->num_bis, biginfo->sub_evt_count,
 	       biginfo->iso_interval,
 	       (biginfo->iso_interval * 5 / 4),
@@ -92,9 +104,14 @@ static void biginfo_cb(struct bt_le_per_adv_sync *sync, const struct bt_iso_bigi
 
     struct broadcast *b = get_broadcast_with_addr(biginfo->addr);
     if (b) {
+        if (!b->has_biginfo || biginfo_changed(&b->biginfo, biginfo)) {
+            broadcast_mark_changed(b);
+        }
         memcpy(&b->biginfo, biginfo, sizeof(*biginfo));
         b->has_biginfo = true;
     }
+
+    PROFILE_END(PROFILE_PA_BIGINFO);
 }
 
 static struct bt_le_per_adv_sync_cb sync_callbacks = {
@@ -110,14 +127,14 @@ static bool scan_get_broadcaster_name(struct bt_data *data, void *user_data) {
 	// this is the official broadcast name
 	if (data->type == BT_DATA_BROADCAST_NAME) {
 		strncpy(name_out, data->data, MIN(data->data_len, BROADCAST_MAX_NAME_LEN - 1));
-        debug_printk("broadcast_name=%s\n", name_out);
+        LOG_DBG("broadcast_name=%s", name_out);
 		return false; // we found the name, stop parsing
 	}
 
 	// this supports non-audio ISO broadcasts
 	if (data->type == BT_DATA_NAME_COMPLETE || data->type == BT_DATA_NAME_SHORTENED) {
 		strncpy(name_out, data->data, MIN(data->data_len, BROADCAST_MAX_NAME_LEN - 1));
-        debug_printk("bt name=%s\n", name_out);
+        LOG_DBG("bt name=%s", name_out);
 		return false;
 	}
 	return true;
@@ -142,7 +159,7 @@ static bool scan_get_broadcast_id(struct bt_data *data, void *user_data) {
 		return true;
 	
 	*broadcast_id = sys_get_le24(data->data + BT_UUID_SIZE_16);
-    debug_printk("broadcast_id=%d\n", *broadcast_id);
+    LOG_DBG("broadcast_id=%d", *broadcast_id);
 	return false; // stop parsing
 }
 
@@ -160,9 +177,12 @@ static struct broadcast* new_broadcast(uint32_t broadcast_id) {
 
 static void broadcast_scan_recv(const struct bt_le_scan_recv_info *info, struct net_buf_simple *ad) {
 
+    PROFILE_START(PROFILE_SCAN_RECV);
     uint32_t broadcast_id = 0;
  	struct net_buf_simple buf_copy;
     char le_addr[BT_ADDR_LE_STR_LEN];
+    char name[BROADCAST_MAX_NAME_LEN] = {0};
+    bool changed = false;
 
 	net_buf_simple_clone(ad, &buf_copy);
 
@@ -177,12 +197,19 @@ static void broadcast_scan_recv(const struct bt_le_scan_recv_info *info, struct
 
 			if (b == NULL) {
 				printk("Yikes! We ran out of space for new broadcasts. Please increase BROADCAST_LIST_MAX_LEN\n");
-				return 1;
+				PROFILE_END(PROFILE_SCAN_RECV);
+				return;
 			}
 
 			bt_addr_le_to_str(info->addr, le_addr, sizeof(le_addr));
 			printk("Found new broadcaster with ID 0x%06X and addr %s and sid 0x%02X\n", broadcast_id,
 			le_addr, info->sid);
+			changed = true;
+		} else {
+			// RSSI and TX power change with every report, only track what identifies the broadcast
+			changed = b->broadcast_id != broadcast_id ||
+				  b->broadcaster_info.sid != info->sid ||
+				  b->broadcaster_info.interval != info->interval;
 		}
 
 		// Store info for PA sync parameters
@@ -190,11 +217,22 @@ static void broadcast_scan_recv(const struct bt_le_scan_recv_info *info, struct
 		bt_addr_le_copy(&b->broadcaster_addr, info->addr);
 		b->broadcast_id = broadcast_id;
 
+		// the name might only be part of the scan response, keep the old one if it's missing
 		net_buf_simple_clone(ad, &buf_copy);
-		bt_data_parse(&buf_copy, scan_get_broadcaster_name, b->broadcaster_name);
+		bt_data_parse(&buf_copy, scan_get_broadcaster_name, name);
+		if (name[0] != '\0' && strcmp(name, b->broadcaster_name) != 0) {
+			memcpy(b->broadcaster_name, name, sizeof(name));
+			changed = true;
+		}
 
 		b->found = true;
+
+		if (changed) {
+			broadcast_mark_changed(b);
+		}
 	}
+
+	PROFILE_END(PROFILE_SCAN_RECV);
 }
 
 static void scan_get_biginfo_for_broadcast(struct broadcast *b) {
@@ -205,7 +243,7 @@ static void scan_get_biginfo_for_broadcast(struct broadcast *b) {
 
 	bt_hci_iso_raw_dump_cb_register(scan_raw_get_biginfo_cb);
 
-    err = pa_sync_create(b);
+    err = pa_sync_create(b, 0);
     if (err) {
         printk("Error syncing to periodic advertisments (0x%x)\n", err);
     }
@@ -215,8 +253,11 @@ static void scan_get_biginfo_for_broadcast(struct broadcast *b) {
         printk("Error: Timeout in getting BIGInfo for stream %s(0x%x)\n", b->broadcaster_name, b->broadcast_id);
     }
 
-	b->sub_interval = tmp_sub_interval;
-	b->bis_spacing = tmp_bis_spacing;
+	if (b->sub_interval != tmp_sub_interval || b->bis_spacing != tmp_bis_spacing) {
+		b->sub_interval = tmp_sub_interval;
+		b->bis_spacing = tmp_bis_spacing;
+		broadcast_mark_changed(b);
+	}
 
     bt_le_per_adv_sync_delete(b->broadcast_sync);
 	bt_hci_iso_raw_dump_cb_register(NULL);
@@ -0,0 +1,376 @@
+#include "auracast_hackers_toolkit.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+
+#if defined(CONFIG_FAT_FILESYSTEM_ELM)
+#include <ff.h>
+#endif
+
+/* Storage sink for the raw dump. Records are appended to one of two RAM blocks in the binary capture
+ * format. Whenever a block is full it is handed to the writer thread and the other one is filled in
+ * the meantime, so the Bluetooth RX thread never waits for the filesystem. Records that don't fit
+ * while the writer is still busy are dropped and counted.
+ *
+ * Records never cross a block boundary, the rest of a block is filled with padding records instead.
+ * Files are rotated between blocks and the file magic is part of the first block, so every write
+ * is a full, aligned block and every file ends with a complete record. */
+
+LOG_MODULE_REGISTER(aht_storage, CONFIG_AHT_LOG_LEVEL);
+
+#define STORAGE_PATH_MAX    64
+
+struct storage_stats {
+	int64_t start;
+	uint64_t bytes;
+	uint32_t records;
+	uint32_t dropped_records;
+	uint32_t blocks;
+	uint32_t files;
+	uint32_t write_errors;
+	uint32_t latency_min_us;
+	uint32_t latency_max_us;
+	uint64_t latency_total_us;
+};
+
+static uint8_t __aligned(4) blocks[2][CONFIG_AHT_STORAGE_BLOCK_SIZE];
+static uint8_t active_block;
+static size_t active_fill;
+/* block handed to the writer thread and its length, -1 if the writer is idle */
+static int pending_block = -1;
+static size_t pending_len;
+/* the writer starts a new file with this block */
+static bool block_new_file[2];
+/* bytes and start time of the file the blocks currently being filled belong to */
+static uint64_t fill_file_bytes;
+static int64_t fill_file_start;
+static struct k_spinlock storage_lock;
+
+static K_SEM_DEFINE(storage_sem, 0, 1);
+static K_THREAD_STACK_DEFINE(storage_stack, CONFIG_AHT_STORAGE_STACK_SIZE);
+static struct k_thread storage_thread;
+static bool storage_thread_started;
+
+static bool storage_active;
+static bool storage_echo;
+static char storage_dir[STORAGE_PATH_MAX];
+static char storage_path[STORAGE_PATH_MAX];
+static struct fs_file_t storage_file;
+static bool file_open;
+static uint32_t file_index;
+static uint32_t rotate_bytes;
+static uint32_t rotate_seconds;
+static struct storage_stats stats;
+
+#if defined(CONFIG_FAT_FILESYSTEM_ELM)
+static FATFS fat_fs;
+static struct fs_mount_t fat_mnt = {
+	.type = FS_FATFS,
+	.fs_data = &fat_fs,
+	.mnt_point = CONFIG_AHT_STORAGE_DIR,
+};
+#endif
+
+bool storage_is_active(void) {
+	return storage_active;
+}
+
+/* must be called with storage_lock held */
+static bool storage_handover(void) {
+	if (pending_block >= 0) {
+		return false;
+	}
+
+	pending_block = active_block;
+	pending_len = active_fill;
+	fill_file_bytes += active_fill;
+	active_block ^= 1;
+	active_fill = 0;
+	k_sem_give(&storage_sem);
+
+	return true;
+}
+
+/* Start filling an empty block, it begins a new file if the current one is due for rotation.
+ * Must be called with storage_lock held. */
+static void storage_begin_block(void) {
+	int64_t now = k_uptime_get();
+	bool rotate = (rotate_bytes > 0 && fill_file_bytes >= rotate_bytes) ||
+		      (rotate_seconds > 0 && now - fill_file_start >= (int64_t)rotate_seconds * MSEC_PER_SEC);
+
+	block_new_file[active_block] = rotate;
+	if (rotate) {
+		fill_file_bytes = 0;
+		fill_file_start = now;
+	}
+	if (fill_file_bytes == 0) {
+		memcpy(blocks[active_block], CAPTURE_FILE_MAGIC, CAPTURE_FILE_MAGIC_LEN);
+		active_fill = CAPTURE_FILE_MAGIC_LEN;
+	}
+}
+
+/* Fill the rest of the active block with padding records. `len` is never below the size of a
+ * record header, see storage_record(). Must be called with storage_lock held. */
+static void storage_pad(size_t len) {
+	const size_t max_pad = sizeof(struct capture_record_hdr) + UINT8_MAX;
+
+	while (len > 0) {
+		/* leave room for another header if this one can't cover the rest */
+		size_t n = len > max_pad ? MIN(max_pad, len - sizeof(struct capture_record_hdr)) : len;
+		struct capture_record_hdr hdr = {
+			.type = CAPTURE_RECORD_PAD,
+			.len = n - sizeof(hdr),
+		};
+
+		memcpy(&blocks[active_block][active_fill], &hdr, sizeof(hdr));
+		memset(&blocks[active_block][active_fill + sizeof(hdr)], 0x00, hdr.len);
+		active_fill += n;
+		len -= n;
+	}
+}
+
+bool storage_record(uint8_t type, uint64_t payload_number, const uint8_t *data, uint8_t len) {
+	struct capture_record_hdr hdr = {
+		.type = type,
+		.len = len,
+		.timestamp_ms = sys_cpu_to_le32(k_uptime_get_32()),
+		.payload_number = sys_cpu_to_le64(payload_number),
+	};
+	size_t size = sizeof(hdr) + len;
+	k_spinlock_key_t key = k_spin_lock(&storage_lock);
+	size_t remaining;
+
+	if (active_fill == 0) {
+		storage_begin_block();
+	}
+
+	/* close the block early if the record doesn't fit or would leave less than a padding header */
+	remaining = sizeof(blocks[0]) - active_fill;
+	if (size > remaining || (size < remaining && remaining - size < sizeof(hdr))) {
+		if (pending_block >= 0) {
+			stats.dropped_records++;
+			k_spin_unlock(&storage_lock, key);
+			return !storage_echo;
+		}
+		storage_pad(remaining);
+		storage_handover();
+		storage_begin_block();
+	}
+
+	memcpy(&blocks[active_block][active_fill], &hdr, sizeof(hdr));
+	memcpy(&blocks[active_block][active_fill + sizeof(hdr)], data, len);
+	active_fill += size;
+
+	if (active_fill == sizeof(blocks[0])) {
+		/* if the writer is busy, the next record hands the block over */
+		storage_handover();
+	}
+
+	stats.records++;
+	k_spin_unlock(&storage_lock, key);
+
+	return !storage_echo;
+}
+
+static int storage_open_next(void) {
+	struct fs_dirent entry;
+	int err;
+
+	/* 8.3 names, so this works on FAT without long file name support */
+	do {
+		snprintf(storage_path, sizeof(storage_path), "%s/cap%04u.bin", storage_dir, file_index++);
+	} while (fs_stat(storage_path, &entry) == 0);
+
+	fs_file_t_init(&storage_file);
+	err = fs_open(&storage_file, storage_path, FS_O_CREATE | FS_O_WRITE);
+	if (err) {
+		LOG_ERR("Error opening capture file %s: %d", storage_path, err);
+		return err;
+	}
+
+	file_open = true;
+	stats.files++;
+	LOG_DBG("Capturing to %s", storage_path);
+
+	return 0;
+}
+
+static void storage_close(void) {
+	if (file_open) {
+		fs_sync(&storage_file);
+		fs_close(&storage_file);
+		file_open = false;
+	}
+}
+
+static void storage_write_block(const uint8_t *block, size_t len, bool new_file) {
+	uint32_t start = k_cycle_get_32();
+	ssize_t written;
+	uint32_t latency_us;
+
+	if (new_file) {
+		storage_close();
+		storage_open_next();
+	}
+	if (!file_open) {
+		stats.write_errors++;
+		return;
+	}
+
+	written = fs_write(&storage_file, block, len);
+	latency_us = k_cyc_to_us_ceil32(k_cycle_get_32() - start);
+
+	if (written != (ssize_t)len) {
+		LOG_DBG("Error writing %zu byte block: %zd", len, written);
+		stats.write_errors++;
+		return;
+	}
+
+	stats.bytes += len;
+	stats.blocks++;
+	stats.latency_total_us += latency_us;
+	stats.latency_max_us = MAX(stats.latency_max_us, latency_us);
+	stats.latency_min_us = stats.blocks == 1 ? latency_us : MIN(stats.latency_min_us, latency_us);
+}
+
+static void storage_thread_fn(void *p1, void *p2, void *p3) {
+	while (true) {
+		k_sem_take(&storage_sem, K_FOREVER);
+
+		storage_write_block(blocks[pending_block], pending_len, block_new_file[pending_block]);
+
+		k_spinlock_key_t key = k_spin_lock(&storage_lock);
+		pending_block = -1;
+		k_spin_unlock(&storage_lock, key);
+	}
+}
+
+/* Hand over the partially filled block and wait until everything is on disk */
+static void storage_flush(void) {
+	bool done = false;
+
+	while (!done) {
+		k_spinlock_key_t key = k_spin_lock(&storage_lock);
+
+		if (active_fill == 0 && pending_block < 0) {
+			done = true;
+		} else if (active_fill > 0) {
+			storage_handover();
+		}
+		k_spin_unlock(&storage_lock, key);
+
+		if (!done) {
+			k_sleep(K_MSEC(1));
+		}
+	}
+}
+
+static int storage_start(const struct shell *sh, size_t argc, char **argv) {
+	int err;
+
+	if (storage_active) {
+		shell_error(sh, "Capture to %s is already running, stop it with `storage stop`", storage_path);
+		return 1;
+	}
+
+	strncpy(storage_dir, CONFIG_AHT_STORAGE_DIR, sizeof(storage_dir) - 1);
+	rotate_bytes = CONFIG_AHT_STORAGE_ROTATE_SIZE * 1024U;
+	rotate_seconds = CONFIG_AHT_STORAGE_ROTATE_SECONDS;
+	storage_echo = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "echo") == 0) {
+			storage_echo = true;
+		} else if (strcmp(argv[i], "size") == 0 && i + 1 < argc) {
+			rotate_bytes = strtoul(argv[++i], NULL, 10) * 1024U;
+		} else if (strcmp(argv[i], "time") == 0 && i + 1 < argc) {
+			rotate_seconds = strtoul(argv[++i], NULL, 10);
+		} else if (argv[i][0] == '/') {
+			strncpy(storage_dir, argv[i], sizeof(storage_dir) - 1);
+		} else {
+			shell_error(sh, "Unknown option %s", argv[i]);
+			return 1;
+		}
+	}
+
+#if defined(CONFIG_FAT_FILESYSTEM_ELM)
+	err = fs_mount(&fat_mnt);
+	if (err && err != -EBUSY) {
+		shell_error(sh, "Error mounting %s: %d", fat_mnt.mnt_point, err);
+		return 1;
+	}
+#endif
+
+	memset(&stats, 0x00, sizeof(stats));
+	active_fill = 0;
+	fill_file_bytes = 0;
+	fill_file_start = k_uptime_get();
+	file_index = 0;
+	err = storage_open_next();
+	if (err) {
+		shell_error(sh, "Error creating capture file in %s: %d", storage_dir, err);
+		storage_close();
+		return 1;
+	}
+	stats.start = k_uptime_get();
+
+	if (!storage_thread_started) {
+		k_thread_create(&storage_thread, storage_stack, K_THREAD_STACK_SIZEOF(storage_stack),
+				storage_thread_fn, NULL, NULL, NULL, CONFIG_AHT_STORAGE_THREAD_PRIORITY, 0,
+				K_NO_WAIT);
+		k_thread_name_set(&storage_thread, "storage");
+		storage_thread_started = true;
+	}
+
+	storage_active = true;
+	shell_info(sh, "Capturing to %s (rotating after %u KiB or %u s)%s", storage_path, rotate_bytes / 1024U,
+		   rotate_seconds, storage_echo ? ", console output stays on" : "");
+
+	return 0;
+}
+
+static int storage_print_stats(const struct shell *sh, size_t argc, char **argv) {
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (stats.start == 0) {
+		shell_error(sh, "No capture has been started yet");
+		return 1;
+	}
+
+	int64_t elapsed_ms = MAX(k_uptime_get() - stats.start, 1);
+
+	shell_print(sh, "%s: %s, %u files", storage_active ? "Capturing" : "Stopped", storage_path, stats.files);
+	shell_print(sh, "Records: %u written, %u dropped", stats.records, stats.dropped_records);
+	shell_print(sh, "Blocks: %u (%llu KiB), %llu KiB/s sustained, %u write errors", stats.blocks,
+		    stats.bytes / 1024U, (stats.bytes * MSEC_PER_SEC / 1024U) / elapsed_ms, stats.write_errors);
+	if (stats.blocks > 0) {
+		shell_print(sh, "Write latency per %u byte block: min %u us, avg %llu us, max %u us",
+			    CONFIG_AHT_STORAGE_BLOCK_SIZE, stats.latency_min_us,
+			    stats.latency_total_us / stats.blocks, stats.latency_max_us);
+	}
+
+	return 0;
+}
+
+static int storage_stop(const struct shell *sh, size_t argc, char **argv) {
+	if (!storage_active) {
+		shell_error(sh, "No capture running");
+		return 1;
+	}
+
+	storage_active = false;
+	storage_flush();
+	storage_close();
+
+	return storage_print_stats(sh, argc, argv);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_storage,
+        SHELL_CMD(start, NULL, "Capture dumps to storage: start [dir] [size <KiB>] [time <s>] [echo]", storage_start),
+        SHELL_CMD(stop, NULL, "Flush and close the capture.", storage_stop),
+        SHELL_CMD(stats, NULL, "Show write throughput, latency and drops.", storage_print_stats),
+        SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(storage, &sub_storage, "Buffered capture to local storage", NULL);
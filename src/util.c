@@ -30,6 +30,30 @@ const char *phy2str(uint8_t phy) {
 	}
 }
 
+/* PA sync timeout in 10 ms units that allows PA_SYNC_INTERVAL_TO_TIMEOUT_RATIO missed events while
+ * only listening to every (skip + 1)th event */
+uint16_t interval_to_sync_timeout(uint16_t pa_interval, uint16_t skip)
+{
+	uint16_t pa_timeout;
+
+	if (pa_interval == BT_BAP_PA_INTERVAL_UNKNOWN || pa_interval == 0) {
+		/* Use maximum value to maximize chance of success */
+		pa_timeout = BT_GAP_PER_ADV_MAX_TIMEOUT;
+	} else {
+		uint32_t interval_ms;
+		uint32_t timeout;
+
+		/* Add retries and convert to unit in 10's of ms */
+		interval_ms = BT_GAP_PER_ADV_INTERVAL_TO_MS(pa_interval) * (skip + 1);
+		timeout = (interval_ms * PA_SYNC_INTERVAL_TO_TIMEOUT_RATIO) / 10;
+
+		/* Enforce restraints */
+		pa_timeout = CLAMP(timeout, BT_GAP_PER_ADV_MIN_TIMEOUT, BT_GAP_PER_ADV_MAX_TIMEOUT);
+	}
+
+	return pa_timeout;
+}
+
 /* This is copied from controller code. For split builds the linker will fail otherwise. */
 uint32_t _util_get_bits(uint8_t *data, uint8_t bit_offs, uint8_t num_bits) {
 	uint32_t value;
@@ -49,4 +73,40 @@ uint32_t _util_get_bits(uint8_t *data, uint8_t bit_offs, uint8_t num_bits) {
 	}
 
 	return value;
-}
\ No newline at end of file
+}
+
+/* Escape a string for use inside a JSON string literal. Output is always NUL terminated and
+ * truncated if it does not fit. Returns the length of the escaped string. */
+size_t json_escape(const char *in, char *out, size_t out_len) {
+	size_t pos = 0;
+
+	if (out_len == 0) {
+		return 0;
+	}
+
+	for (; *in != '\0'; in++) {
+		uint8_t c = *in;
+		char esc[7];
+		size_t esc_len;
+
+		if (c == '"' || c == '\\') {
+			esc[0] = '\\';
+			esc[1] = c;
+			esc_len = 2;
+		} else if (c < 0x20) {
+			esc_len = snprintf(esc, sizeof(esc), "\\u%04x", c);
+		} else {
+			esc[0] = c;
+			esc_len = 1;
+		}
+
+		if (pos + esc_len >= out_len) {
+			break;
+		}
+		memcpy(&out[pos], esc, esc_len);
+		pos += esc_len;
+	}
+
+	out[pos] = '\0';
+	return pos;
+}